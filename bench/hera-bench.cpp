@@ -0,0 +1,429 @@
+// Benchmark of the Hera distances on diagrams of growing size, built without
+// R against the headers in src/hera (see README.md). Every case runs in a
+// child process, so that its peak memory is its own and a case over the time
+// limit can be killed; the results are written as CSV, one row per case.
+#include "hera/wasserstein.h"
+#include "hera/bottleneck.h"
+#include "hera/common/diagram_reader.h"
+#include "synthetic_diagrams.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <set>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using PairVector = std::vector<std::pair<double,double>>;
+
+struct Options
+{
+  std::vector<std::string> distances { "wasserstein" };
+  std::vector<double> sizes { 1e2, 1e3, 1e4, 1e5, 1e6 };
+  std::vector<double> powers { 1.0, 2.0 };
+  std::vector<double> internal_ps { std::numeric_limits<double>::infinity(), 2.0 };
+  std::vector<double> tols { 0.01 };
+  SyntheticDiagramParams generator;
+  std::string manifest;
+  bool synthetic { true };
+  unsigned int reps { 1 };
+  unsigned int timeout { 600 };
+  unsigned int seed { 1 };
+  std::string output;
+};
+
+// Where the diagrams of a case come from: synthetic diagrams of n points, or
+// a pair of files of the manifest.
+struct Case
+{
+  std::string distance;
+  std::string dataset;
+  std::size_t n;
+  std::string fileA, fileB;
+  double p, internal_p, tol;
+};
+
+// What a child process reports back through its pipe.
+struct Measurement
+{
+  std::size_t n_a, n_b;
+  double setup_seconds;
+  double seconds_min, seconds_median;
+  double value;
+  long peak_rss_kb;
+  bool ok;
+};
+
+PairVector readDiagram(const std::string& fname)
+{
+  PairVector result;
+  if (!hera::read_diagram_point_set<double>(fname, result))
+    throw std::runtime_error("cannot read diagram " + fname);
+  return result;
+}
+
+double computeDistance(const Case& c, PairVector& diagramA, PairVector& diagramB)
+{
+  // the calls of bottleneckDistance() and wassersteinDistance()
+  if (c.distance == "bottleneck")
+  {
+    hera::bt::MatchingEdge<double> e;
+    if (c.tol > 0.0)
+      return hera::bottleneckDistApprox(diagramA, diagramB, c.tol, e, true);
+    int decPrecision { 0 };
+    return hera::bottleneckDistExact(diagramA, diagramB, decPrecision);
+  }
+
+  hera::AuctionParams<double> params;
+  params.wasserstein_power = c.p;
+  params.internal_p = std::isinf(c.internal_p) ? hera::get_infinity<double>() : c.internal_p;
+  params.delta = c.tol;
+  params.remove_duplicates = c.p == 1.0;
+  // the defaults of wassersteinDist(), with the oracle that `oracle = "auto"`
+  // selects in R
+  params.adaptive_epsilon = true;
+  params.oracle_type = hera::AuctionOracleType::automatic;
+  return hera::wasserstein_cost_detailed(diagramA, diagramB, params).distance;
+}
+
+long peakMemoryKb()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+}
+
+// The body of the child process; the distance is recomputed from fresh
+// copies of the diagrams at each repetition.
+Measurement measureCase(const Case& c, const Options& options)
+{
+  using clock = std::chrono::steady_clock;
+  Measurement result {};
+
+  auto start = clock::now();
+  PairVector diagramA, diagramB;
+  if (c.fileA.empty())
+  {
+    diagramA = syntheticDiagram(c.n, options.generator, 2 * options.seed);
+    diagramB = syntheticDiagram(c.n, options.generator, 2 * options.seed + 1);
+  }
+  else
+  {
+    diagramA = readDiagram(c.fileA);
+    diagramB = readDiagram(c.fileB);
+  }
+  result.setup_seconds = std::chrono::duration<double>(clock::now() - start).count();
+  result.n_a = diagramA.size();
+  result.n_b = diagramB.size();
+
+  std::vector<double> seconds;
+  for (unsigned int r = 0;r < options.reps;++r)
+  {
+    PairVector a = diagramA, b = diagramB;
+    start = clock::now();
+    result.value = computeDistance(c, a, b);
+    seconds.push_back(std::chrono::duration<double>(clock::now() - start).count());
+  }
+  std::sort(seconds.begin(), seconds.end());
+  result.seconds_min = seconds.front();
+  result.seconds_median = seconds[seconds.size() / 2];
+  result.peak_rss_kb = peakMemoryKb();
+  result.ok = true;
+  return result;
+}
+
+// Runs a case in a child process killed after `timeout` seconds; returns the
+// status of the case, "ok", "timeout" or "error".
+std::string runCase(const Case& c, const Options& options, Measurement& result)
+{
+  int fd[2];
+  if (pipe(fd) != 0)
+    return "error";
+
+  pid_t pid = fork();
+  if (pid < 0)
+  {
+    close(fd[0]);
+    close(fd[1]);
+    return "error";
+  }
+  if (pid == 0)
+  {
+    close(fd[0]);
+    alarm(options.timeout);
+    Measurement m {};
+    try
+    {
+      m = measureCase(c, options);
+    }
+    catch (const std::exception& e)
+    {
+      std::cerr << "error: " << e.what() << std::endl;
+    }
+    ssize_t written = write(fd[1], &m, sizeof(m));
+    _exit(written == sizeof(m) ? 0 : 1);
+  }
+
+  close(fd[1]);
+  result = Measurement {};
+  ssize_t count = read(fd[0], &result, sizeof(result));
+  close(fd[0]);
+  int status = 0;
+  waitpid(pid, &status, 0);
+
+  if (WIFSIGNALED(status) && WTERMSIG(status) == SIGALRM)
+    return "timeout";
+  if (count != sizeof(result) || !result.ok)
+    return "error";
+  return "ok";
+}
+
+std::string formatReal(const double x)
+{
+  if (std::isinf(x))
+    return x > 0 ? "inf" : "-inf";
+  std::ostringstream out;
+  out.precision(std::numeric_limits<double>::max_digits10);
+  out << x;
+  return out.str();
+}
+
+std::vector<std::string> splitList(const std::string& s)
+{
+  std::vector<std::string> result;
+  std::stringstream in(s);
+  std::string item;
+  while (std::getline(in, item, ','))
+    if (!item.empty())
+      result.push_back(item);
+  return result;
+}
+
+std::vector<double> parseReals(const std::string& s)
+{
+  std::vector<double> result;
+  for (const auto& item : splitList(s))
+  {
+    if (item == "inf" || item == "Inf")
+      result.push_back(std::numeric_limits<double>::infinity());
+    else
+      result.push_back(std::stod(item));
+  }
+  return result;
+}
+
+void printUsage()
+{
+  std::cerr <<
+    "usage: hera-bench [options]\n"
+    "  --distance LIST    wasserstein and/or bottleneck (wasserstein)\n"
+    "  --sizes LIST       points per synthetic diagram (1e2,1e3,1e4,1e5,1e6)\n"
+    "  --noise X          mean persistence of the synthetic noise (0.05)\n"
+    "  --features N       high-persistence points per synthetic diagram (10)\n"
+    "  --essential N      points at infinity per synthetic diagram (1)\n"
+    "  --duplicates X     rate of duplicated synthetic noise points (0)\n"
+    "  --p LIST           Wasserstein powers (1,2)\n"
+    "  --internal-p LIST  norms between points, inf for the max norm (inf,2)\n"
+    "  --tol LIST         relative errors, 0 for the exact bottleneck (0.01)\n"
+    "  --manifest FILE    also run the pairs of diagrams listed in FILE\n"
+    "  --no-synthetic     run the manifest only\n"
+    "  --reps N           repetitions of each case (1)\n"
+    "  --timeout S        seconds before a case is killed (600)\n"
+    "  --seed N           seed of the synthetic diagrams (1)\n"
+    "  --output FILE      CSV file of results (standard output)\n";
+}
+
+bool parseOptions(int argc, char** argv, Options& options)
+{
+  for (int i = 1;i < argc;++i)
+  {
+    std::string arg = argv[i];
+    if (arg == "--no-synthetic")
+    {
+      options.synthetic = false;
+      continue;
+    }
+    if (arg == "--help" || i + 1 == argc)
+      return false;
+
+    std::string value = argv[++i];
+    if (arg == "--distance")
+      options.distances = splitList(value);
+    else if (arg == "--sizes")
+      options.sizes = parseReals(value);
+    else if (arg == "--noise")
+      options.generator.noise_persistence = std::stod(value);
+    else if (arg == "--features")
+      options.generator.num_features = std::stoul(value);
+    else if (arg == "--essential")
+      options.generator.num_essential = std::stoul(value);
+    else if (arg == "--duplicates")
+      options.generator.duplicate_rate = std::stod(value);
+    else if (arg == "--p")
+      options.powers = parseReals(value);
+    else if (arg == "--internal-p")
+      options.internal_ps = parseReals(value);
+    else if (arg == "--tol")
+      options.tols = parseReals(value);
+    else if (arg == "--manifest")
+      options.manifest = value;
+    else if (arg == "--reps")
+      options.reps = std::max(1, std::stoi(value));
+    else if (arg == "--timeout")
+      options.timeout = std::stoi(value);
+    else if (arg == "--seed")
+      options.seed = std::stoi(value);
+    else if (arg == "--output")
+      options.output = value;
+    else
+      return false;
+  }
+
+  for (const auto& distance : options.distances)
+    if (distance != "wasserstein" && distance != "bottleneck")
+      return false;
+  std::sort(options.sizes.begin(), options.sizes.end());
+  return true;
+}
+
+// The pairs of the manifest, one per line: a dataset name and two diagram
+// files in the format of hera::read_diagram_point_set(), relative to the
+// manifest.
+std::vector<std::tuple<std::string, std::string, std::string>> readManifest(const std::string& fname)
+{
+  std::vector<std::tuple<std::string, std::string, std::string>> result;
+  std::ifstream in(fname);
+  if (!in)
+    throw std::runtime_error("cannot read manifest " + fname);
+
+  std::string dir;
+  auto slash = fname.find_last_of('/');
+  if (slash != std::string::npos)
+    dir = fname.substr(0, slash + 1);
+
+  std::string line;
+  while (std::getline(in, line))
+  {
+    std::istringstream fields(line);
+    std::string dataset, fileA, fileB;
+    if (line.empty() || line[0] == '#' || !(fields >> dataset >> fileA >> fileB))
+      continue;
+    result.emplace_back(dataset, dir + fileA, dir + fileB);
+  }
+  return result;
+}
+
+// The cases of the sweep, synthetic ones by increasing size; the bottleneck
+// distance only depends on the tolerance.
+std::vector<Case> sweepCases(const Options& options)
+{
+  const double inf = std::numeric_limits<double>::infinity();
+  std::vector<std::tuple<std::string, std::string, std::string>> pairs;
+  if (!options.manifest.empty())
+    pairs = readManifest(options.manifest);
+
+  std::vector<Case> result;
+  for (const auto& distance : options.distances)
+  {
+    bool bottleneck = distance == "bottleneck";
+    for (double p : bottleneck ? std::vector<double> { inf } : options.powers)
+      for (double internal_p : bottleneck ? std::vector<double> { inf } : options.internal_ps)
+        for (double tol : options.tols)
+        {
+          if (options.synthetic)
+            for (double n : options.sizes)
+              result.push_back({ distance, "synthetic", static_cast<std::size_t>(n), "", "", p, internal_p, tol });
+          for (const auto& pair : pairs)
+            result.push_back({ distance, std::get<0>(pair), 0, std::get<1>(pair), std::get<2>(pair), p, internal_p, tol });
+        }
+  }
+  return result;
+}
+
+int main(int argc, char** argv)
+{
+  Options options;
+  if (!parseOptions(argc, argv, options))
+  {
+    printUsage();
+    return 2;
+  }
+
+  std::vector<Case> cases;
+  try
+  {
+    cases = sweepCases(options);
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  std::ofstream file;
+  if (!options.output.empty())
+  {
+    file.open(options.output);
+    if (!file)
+    {
+      std::cerr << "cannot write " << options.output << std::endl;
+      return 1;
+    }
+  }
+  std::ostream& out = options.output.empty() ? std::cout : file;
+
+  out << "distance,dataset,n_a,n_b,p,internal_p,tol,reps,setup_seconds,"
+      << "seconds_min,seconds_median,value,peak_rss_kb,status" << std::endl;
+
+  // a synthetic case over the time limit is not repeated on larger diagrams
+  std::set<std::tuple<std::string, double, double, double>> timed_out;
+  for (const auto& c : cases)
+  {
+    auto key = std::make_tuple(c.distance, c.p, c.internal_p, c.tol);
+    bool synthetic = c.fileA.empty();
+    Measurement m {};
+    std::string status = "skipped";
+    if (!synthetic || !timed_out.count(key))
+      status = runCase(c, options, m);
+    if (synthetic && status == "timeout")
+      timed_out.insert(key);
+    if (synthetic && status != "ok")
+      m.n_a = m.n_b = c.n;
+
+    std::cerr << c.distance << " " << c.dataset << " n=" << m.n_a << "/" << m.n_b
+              << " p=" << formatReal(c.p) << " q=" << formatReal(c.internal_p)
+              << " tol=" << c.tol << ": " << status;
+    if (status == "ok")
+      std::cerr << " " << m.seconds_median << "s " << m.peak_rss_kb << "kB";
+    std::cerr << std::endl;
+
+    out << c.distance << "," << c.dataset << "," << m.n_a << "," << m.n_b << ","
+        << formatReal(c.p) << "," << formatReal(c.internal_p) << ","
+        << formatReal(c.tol) << "," << options.reps << ",";
+    if (status == "ok")
+      out << m.setup_seconds << "," << m.seconds_min << "," << m.seconds_median << ","
+          << formatReal(m.value) << "," << m.peak_rss_kb;
+    else
+      out << "NA,NA,NA,NA,NA";
+    out << "," << status << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,294 @@
+#include "barycenter.h"
+#include "diagram_parser.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+WassersteinBarycenter::WassersteinBarycenter(const std::vector<Diagram>& diagrams,
+                                             const hera::AuctionParams<double>& params) :
+  params_(params),
+  diagrams_(diagrams),
+  entries_(diagrams.size())
+{
+  params_.wasserstein_power = 2.0;
+  params_.internal_p = 2.0;
+  params_.return_matching = true;
+  params_.prune_error_budget = 0.0;
+
+  // ids are rows of the diagrams, so that matchings refer to them
+  for (size_t i = 0;i < diagrams_.size();++i)
+  {
+    const Diagram& diagram = diagrams_[i];
+    for (size_t row = 0;row < diagram.size();++row)
+    {
+      const auto& point = diagram[row];
+      if (point.first != point.second &&
+          std::isfinite(point.first) && std::isfinite(point.second))
+      {
+        entries_[i].diagram.add_point(point.first, point.second, row);
+        entries_[i].sorted_points.emplace_back(point.first, point.second, row);
+      }
+    }
+    std::sort(entries_[i].sorted_points.begin(), entries_[i].sorted_points.end());
+  }
+}
+
+std::vector<int> WassersteinBarycenter::unmatched(size_t i) const
+{
+  std::vector<bool> matched(diagrams_[i].size(), false);
+  for (int row : entries_[i].matching)
+  {
+    if (row >= 0)
+      matched[row] = true;
+  }
+  std::vector<int> result;
+  for (const auto& point : entries_[i].diagram.finite_points)
+  {
+    if (!matched[point.id])
+      result.push_back(point.id);
+  }
+  return result;
+}
+
+void WassersteinBarycenter::match(const DiagramPointVector& previous, unsigned int ncores)
+{
+  hera::ws::PreparedDiagram<double> barycenter;
+  SortedPoints sorted_barycenter;
+  for (size_t j = 0;j < barycenter_.size();++j)
+  {
+    barycenter.add_point(barycenter_[j].first, barycenter_[j].second, j);
+    sorted_barycenter.emplace_back(barycenter_[j].first, barycenter_[j].second, j);
+  }
+  std::sort(sorted_barycenter.begin(), sorted_barycenter.end());
+  auto equalPoints = [](const SortedPoints& a, const SortedPoints& b) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+                      [](const std::tuple<double,double,int>& p, const std::tuple<double,double,int>& q) {
+                        return std::get<0>(p) == std::get<0>(q) && std::get<1>(p) == std::get<1>(q);
+                      });
+  };
+
+  NearestPointIndex index(previous);
+  const int N = entries_.size();
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(ncores) schedule(dynamic)
+#endif
+  for (int i = 0;i < N;++i)
+  {
+    Entry& entry = entries_[i];
+    auto params = params_;
+
+    // the auction cannot certify a zero cost, equal diagrams are matched
+    // point by point in sorted order
+    if (equalPoints(sorted_barycenter, entry.sorted_points))
+    {
+      entry.matching.assign(barycenter_.size(), -1);
+      for (size_t k = 0;k < sorted_barycenter.size();++k)
+        entry.matching[std::get<2>(sorted_barycenter[k])] = std::get<2>(entry.sorted_points[k]);
+      entry.prices.clear();
+      entry.epsilon = entry.distance = entry.cost = 0.0;
+      continue;
+    }
+
+    // item prices are those of the projections of Y, carried over from the
+    // nearest previous point, followed by those of D_i, which is unchanged
+    std::vector<double> prices;
+    const size_t num_points = entry.diagram.finite_points.size();
+    if (!previous.empty() && entry.prices.size() == previous.size() + num_points)
+    {
+      std::vector<double> previous_prices(entry.prices.begin(), entry.prices.begin() + previous.size());
+      prices.reserve(barycenter.finite_points.size() + num_points);
+      double shift = remapPrices(index, previous_prices, barycenter.finite_points, prices);
+      prices.insert(prices.end(), entry.prices.begin() + previous.size(), entry.prices.end());
+      params.initial_epsilon = warmStartEpsilon(entry.epsilon, entry.distance, shift,
+                                                params.wasserstein_power);
+    }
+
+    auto res = hera::ws::wasserstein_cost_prepared(barycenter, entry.diagram, params, prices);
+    res.resize_matching(barycenter_.size(), 0);
+
+    entry.prices = std::move(res.prices);
+    entry.epsilon = res.final_epsilon;
+    entry.distance = res.distance;
+    entry.cost = res.cost;
+    entry.matching.assign(res.matching_a_to_b_.begin(),
+                          res.matching_a_to_b_.begin() + barycenter_.size());
+  }
+
+  cost_ = 0.0;
+  for (const auto& entry : entries_)
+    cost_ += entry.cost;
+  cost_ /= N;
+}
+
+void WassersteinBarycenter::update()
+{
+  const double N = entries_.size();
+  Diagram result;
+
+  // points of Y move to the mean of their partners, the diagonal standing
+  // for the projection of the point itself
+  for (size_t j = 0;j < barycenter_.size();++j)
+  {
+    const auto& point = barycenter_[j];
+    const double projection = (point.first + point.second) / 2.0;
+    double x = 0.0, y = 0.0;
+    for (size_t i = 0;i < entries_.size();++i)
+    {
+      const int row = entries_[i].matching[j];
+      if (row < 0)
+      {
+        x += projection;
+        y += projection;
+      }
+      else
+      {
+        x += diagrams_[i][row].first;
+        y += diagrams_[i][row].second;
+      }
+    }
+    if (x / N < y / N)
+      result.emplace_back(x / N, y / N);
+  }
+
+  // points matched to the diagonal start a new point of Y, matched to them
+  // in their own diagram and to the diagonal in all the others
+  for (size_t i = 0;i < entries_.size();++i)
+  {
+    for (int row : unmatched(i))
+    {
+      const auto& point = diagrams_[i][row];
+      const double projection = (point.first + point.second) / 2.0;
+      const double x = (point.first + (N - 1.0) * projection) / N;
+      const double y = (point.second + (N - 1.0) * projection) / N;
+      if (x < y)
+        result.emplace_back(x, y);
+    }
+  }
+
+  barycenter_ = std::move(result);
+}
+
+void WassersteinBarycenter::run(const Diagram& initial, double threshold, int max_iter, unsigned int ncores)
+{
+  barycenter_.clear();
+  for (const auto& point : initial)
+  {
+    if (point.first < point.second &&
+        std::isfinite(point.first) && std::isfinite(point.second))
+      barycenter_.push_back(point);
+  }
+  for (auto& entry : entries_)
+    entry.prices.clear();
+
+  DiagramPointVector previous;
+  double previous_cost = std::numeric_limits<double>::infinity();
+  num_iterations_ = 0;
+  while (true)
+  {
+    match(previous, ncores);
+    ++num_iterations_;
+
+    // the cost of the matchings of the updated Y cannot exceed that of Y,
+    // up to the relative error of the auctions
+    if (entries_.empty() || num_iterations_ >= max_iter ||
+        previous_cost - cost_ <= threshold * cost_)
+      break;
+    previous_cost = cost_;
+
+    previous.clear();
+    for (size_t j = 0;j < barycenter_.size();++j)
+      previous.emplace_back(barycenter_[j].first, barycenter_[j].second,
+                            hera::DiagramPoint<double>::NORMAL, j);
+    update();
+  }
+}
+
+// The barycenter as a 2-column matrix and, for every diagram, its matching
+// to the barycenter as in wassersteinMatching: 1-based rows of the
+// barycenter and of the diagram, -1 for the diagonal, and the Euclidean
+// length of each edge.
+[[cpp11::register]]
+cpp11::list wassersteinBarycenter(const cpp11::list& x,
+                                  const cpp11::doubles_matrix<>& init,
+                                  const double delta = 0.01,
+                                  const double threshold = 1e-6,
+                                  const int max_iter = 100,
+                                  const unsigned int ncores = 1)
+{
+  using namespace cpp11::literals;
+
+  hera::AuctionParams<double> params;
+  params.delta = delta;
+  params.adaptive_epsilon = true;
+  if (params.delta <= 0.0)
+    cpp11::stop("relative error must be a number > 0.0. Cannot proceed.");
+
+  std::vector<PairVector> diagrams(x.size());
+  for (int n = 0;n < x.size();++n)
+    parseMatrix(cpp11::as_cpp<cpp11::doubles_matrix<>>(x[n]), diagrams[n]);
+  PairVector initial;
+  parseMatrix(init, initial);
+
+  WassersteinBarycenter barycenter(diagrams, params);
+  barycenter.run(initial, threshold, max_iter, ncores);
+
+  const auto& Y = barycenter.barycenter();
+  cpp11::writable::doubles_matrix<> points(Y.size(), 2);
+  for (size_t j = 0;j < Y.size();++j)
+  {
+    points(j, 0) = Y[j].first;
+    points(j, 1) = Y[j].second;
+  }
+
+  auto edgeLength = [](const std::pair<double,double>& a, const std::pair<double,double>* b) {
+    if (b == nullptr)
+      return std::fabs(a.second - a.first) / std::sqrt(2.0);
+    return std::hypot(a.first - b->first, a.second - b->second);
+  };
+
+  cpp11::writable::list matchings(barycenter.size());
+  for (size_t i = 0;i < barycenter.size();++i)
+  {
+    const auto& matching = barycenter.matching(i);
+    const auto unmatched = barycenter.unmatched(i);
+    const auto& diagram = barycenter.diagram(i);
+    const int numEdges = matching.size() + unmatched.size();
+
+    cpp11::writable::integers rowsY(numEdges), rowsD(numEdges);
+    cpp11::writable::doubles lengths(numEdges);
+    int k = 0;
+    for (size_t j = 0;j < matching.size();++j, ++k)
+    {
+      const int row = matching[j];
+      rowsY[k] = j + 1;
+      rowsD[k] = row < 0 ? -1 : row + 1;
+      lengths[k] = edgeLength(Y[j], row < 0 ? nullptr : &diagram[row]);
+    }
+    for (int row : unmatched)
+    {
+      rowsY[k] = -1;
+      rowsD[k] = row + 1;
+      lengths[k] = edgeLength(diagram[row], nullptr);
+      ++k;
+    }
+
+    matchings[i] = cpp11::writable::list({
+      "x"_nm = rowsY,
+      "y"_nm = rowsD,
+      "cost"_nm = lengths
+    });
+  }
+
+  return cpp11::writable::list({
+    "barycenter"_nm = points,
+    "cost"_nm = barycenter.cost(),
+    "iterations"_nm = barycenter.num_iterations(),
+    "matchings"_nm = matchings
+  });
+}
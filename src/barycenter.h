@@ -0,0 +1,70 @@
+#ifndef PHUTIL_BARYCENTER_H
+#define PHUTIL_BARYCENTER_H
+
+#include "hera/wasserstein.h"
+#include "warm_start.h"
+
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// Frechet mean of persistence diagrams for the 2-Wasserstein distance with
+// Euclidean ground metric (Turner, Mileyko, Mukherjee and Harer, 2014). Each
+// iteration matches the current barycenter Y to every diagram D_i and moves
+// every point of Y to the mean of the points it is matched to, the diagonal
+// standing for its own projection; a point of D_i matched to the diagonal
+// adds the point (x + (N - 1) proj(x)) / N to Y, and points of Y that reach
+// the diagonal are dropped. The N auctions of an iteration run in parallel
+// and each is warm-started from the prices of the same diagram in the
+// previous iteration. Points at infinity are ignored.
+class WassersteinBarycenter
+{
+public:
+  using Diagram = std::vector<std::pair<double,double>>;
+
+  WassersteinBarycenter(const std::vector<Diagram>& diagrams,
+                        const hera::AuctionParams<double>& params);
+
+  // Iterates from initial until the mean cost decreases by less than a
+  // fraction threshold of itself, or for max_iter iterations.
+  void run(const Diagram& initial, double threshold, int max_iter, unsigned int ncores = 1);
+
+  const Diagram& barycenter() const { return barycenter_; }
+  // mean of W_2^2(Y, D_i) over the diagrams
+  double cost() const { return cost_; }
+  int num_iterations() const { return num_iterations_; }
+  size_t size() const { return entries_.size(); }
+  // matching(i)[j] is the row of D_i matched to point j of Y, or -1 for
+  // the diagonal; unmatched(i) are the rows of D_i matched to the diagonal
+  const std::vector<int>& matching(size_t i) const { return entries_[i].matching; }
+  std::vector<int> unmatched(size_t i) const;
+  const Diagram& diagram(size_t i) const { return diagrams_[i]; }
+
+private:
+  // birth, death, position
+  using SortedPoints = std::vector<std::tuple<double,double,int>>;
+
+  struct Entry
+  {
+    hera::ws::PreparedDiagram<double> diagram;
+    SortedPoints sorted_points;
+    std::vector<double> prices;
+    double epsilon {0.0};
+    double distance {0.0};
+    double cost {0.0};
+    std::vector<int> matching;
+  };
+
+  // matches Y to every diagram, warm-started from the previous Y
+  void match(const DiagramPointVector& previous, unsigned int ncores);
+  void update();
+
+  hera::AuctionParams<double> params_;
+  std::vector<Diagram> diagrams_;
+  std::vector<Entry> entries_;
+  Diagram barycenter_;
+  double cost_ {0.0};
+  int num_iterations_ {0};
+};
+
+#endif // PHUTIL_BARYCENTER_H
@@ -5,6 +5,13 @@
 #include "cpp11/declarations.hpp"
 #include <R_ext/Visibility.h>
 
+// barycenter.cpp
+cpp11::list wassersteinBarycenter(const cpp11::list& x, const cpp11::doubles_matrix<>& init, const double delta, const double threshold, const int max_iter, const unsigned int ncores);
+extern "C" SEXP _phutil_wassersteinBarycenter(SEXP x, SEXP init, SEXP delta, SEXP threshold, SEXP max_iter, SEXP ncores) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(wassersteinBarycenter(cpp11::as_cpp<cpp11::decay_t<const cpp11::list&>>(x), cpp11::as_cpp<cpp11::decay_t<const cpp11::doubles_matrix<>&>>(init), cpp11::as_cpp<cpp11::decay_t<const double>>(delta), cpp11::as_cpp<cpp11::decay_t<const double>>(threshold), cpp11::as_cpp<cpp11::decay_t<const int>>(max_iter), cpp11::as_cpp<cpp11::decay_t<const unsigned int>>(ncores)));
+  END_CPP11
+}
 // bottleneck.cpp
 double bottleneckDistance(const cpp11::doubles_matrix<>& x, const cpp11::doubles_matrix<>& y, const double delta);
 extern "C" SEXP _phutil_bottleneckDistance(SEXP x, SEXP y, SEXP delta) {
@@ -19,27 +26,172 @@ extern "C" SEXP _phutil_bottleneckPairwiseDistances(SEXP x, SEXP delta, SEXP nco
     return cpp11::as_sexp(bottleneckPairwiseDistances(cpp11::as_cpp<cpp11::decay_t<const cpp11::list&>>(x), cpp11::as_cpp<cpp11::decay_t<const double>>(delta), cpp11::as_cpp<cpp11::decay_t<const unsigned int>>(ncores)));
   END_CPP11
 }
+// diagram_index.cpp
+cpp11::list diagramIndexBuild(const cpp11::list& x, const cpp11::integers& order, const int metric_type, const double delta, const double wasserstein_power, const unsigned int ncores);
+extern "C" SEXP _phutil_diagramIndexBuild(SEXP x, SEXP order, SEXP metric_type, SEXP delta, SEXP wasserstein_power, SEXP ncores) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(diagramIndexBuild(cpp11::as_cpp<cpp11::decay_t<const cpp11::list&>>(x), cpp11::as_cpp<cpp11::decay_t<const cpp11::integers&>>(order), cpp11::as_cpp<cpp11::decay_t<const int>>(metric_type), cpp11::as_cpp<cpp11::decay_t<const double>>(delta), cpp11::as_cpp<cpp11::decay_t<const double>>(wasserstein_power), cpp11::as_cpp<cpp11::decay_t<const unsigned int>>(ncores)));
+  END_CPP11
+}
+// diagram_index.cpp
+cpp11::list diagramIndexKnn(const cpp11::list& index, const cpp11::list& x, const int k, const unsigned int ncores);
+extern "C" SEXP _phutil_diagramIndexKnn(SEXP index, SEXP x, SEXP k, SEXP ncores) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(diagramIndexKnn(cpp11::as_cpp<cpp11::decay_t<const cpp11::list&>>(index), cpp11::as_cpp<cpp11::decay_t<const cpp11::list&>>(x), cpp11::as_cpp<cpp11::decay_t<const int>>(k), cpp11::as_cpp<cpp11::decay_t<const unsigned int>>(ncores)));
+  END_CPP11
+}
+// diagram_index.cpp
+cpp11::list diagramIndexRange(const cpp11::list& index, const cpp11::list& x, const double radius, const unsigned int ncores);
+extern "C" SEXP _phutil_diagramIndexRange(SEXP index, SEXP x, SEXP radius, SEXP ncores) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(diagramIndexRange(cpp11::as_cpp<cpp11::decay_t<const cpp11::list&>>(index), cpp11::as_cpp<cpp11::decay_t<const cpp11::list&>>(x), cpp11::as_cpp<cpp11::decay_t<const double>>(radius), cpp11::as_cpp<cpp11::decay_t<const unsigned int>>(ncores)));
+  END_CPP11
+}
+// kdtree_threads.cpp
+int setKdTreeThreads(const int threads);
+extern "C" SEXP _phutil_setKdTreeThreads(SEXP threads) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(setKdTreeThreads(cpp11::as_cpp<cpp11::decay_t<const int>>(threads)));
+  END_CPP11
+}
+// sinkhorn.cpp
+cpp11::doubles sinkhornPairwiseDistances(const cpp11::list& x, const double wasserstein_power, const double epsilon, const double tolerance, const int max_iter, const unsigned int ncores);
+extern "C" SEXP _phutil_sinkhornPairwiseDistances(SEXP x, SEXP wasserstein_power, SEXP epsilon, SEXP tolerance, SEXP max_iter, SEXP ncores) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(sinkhornPairwiseDistances(cpp11::as_cpp<cpp11::decay_t<const cpp11::list&>>(x), cpp11::as_cpp<cpp11::decay_t<const double>>(wasserstein_power), cpp11::as_cpp<cpp11::decay_t<const double>>(epsilon), cpp11::as_cpp<cpp11::decay_t<const double>>(tolerance), cpp11::as_cpp<cpp11::decay_t<const int>>(max_iter), cpp11::as_cpp<cpp11::decay_t<const unsigned int>>(ncores)));
+  END_CPP11
+}
+// sliced_wasserstein.cpp
+cpp11::doubles slicedWassersteinPairwiseDistances(const cpp11::list& x, const int num_directions, const unsigned int ncores);
+extern "C" SEXP _phutil_slicedWassersteinPairwiseDistances(SEXP x, SEXP num_directions, SEXP ncores) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(slicedWassersteinPairwiseDistances(cpp11::as_cpp<cpp11::decay_t<const cpp11::list&>>(x), cpp11::as_cpp<cpp11::decay_t<const int>>(num_directions), cpp11::as_cpp<cpp11::decay_t<const unsigned int>>(ncores)));
+  END_CPP11
+}
+// sliced_wasserstein.cpp
+cpp11::doubles_matrix<> slicedWassersteinCrossDistances(const cpp11::list& x, const cpp11::list& y, const int num_directions, const unsigned int ncores);
+extern "C" SEXP _phutil_slicedWassersteinCrossDistances(SEXP x, SEXP y, SEXP num_directions, SEXP ncores) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(slicedWassersteinCrossDistances(cpp11::as_cpp<cpp11::decay_t<const cpp11::list&>>(x), cpp11::as_cpp<cpp11::decay_t<const cpp11::list&>>(y), cpp11::as_cpp<cpp11::decay_t<const int>>(num_directions), cpp11::as_cpp<cpp11::decay_t<const unsigned int>>(ncores)));
+  END_CPP11
+}
+// synthetic_diagrams_r.cpp
+cpp11::doubles_matrix<> syntheticDiagramMatrix(const int n, const double max_birth, const double noise_persistence, const double duplicate_rate, const int num_features, const double feature_persistence, const int num_essential, const int seed);
+extern "C" SEXP _phutil_syntheticDiagramMatrix(SEXP n, SEXP max_birth, SEXP noise_persistence, SEXP duplicate_rate, SEXP num_features, SEXP feature_persistence, SEXP num_essential, SEXP seed) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(syntheticDiagramMatrix(cpp11::as_cpp<cpp11::decay_t<const int>>(n), cpp11::as_cpp<cpp11::decay_t<const double>>(max_birth), cpp11::as_cpp<cpp11::decay_t<const double>>(noise_persistence), cpp11::as_cpp<cpp11::decay_t<const double>>(duplicate_rate), cpp11::as_cpp<cpp11::decay_t<const int>>(num_features), cpp11::as_cpp<cpp11::decay_t<const double>>(feature_persistence), cpp11::as_cpp<cpp11::decay_t<const int>>(num_essential), cpp11::as_cpp<cpp11::decay_t<const int>>(seed)));
+  END_CPP11
+}
+// wasserstein.cpp
+double wassersteinDistance(const cpp11::doubles_matrix<>& x, const cpp11::doubles_matrix<>& y, const double delta, const double wasserstein_power, const int oracle_type, const bool adaptive_epsilon);
+extern "C" SEXP _phutil_wassersteinDistance(SEXP x, SEXP y, SEXP delta, SEXP wasserstein_power, SEXP oracle_type, SEXP adaptive_epsilon) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(wassersteinDistance(cpp11::as_cpp<cpp11::decay_t<const cpp11::doubles_matrix<>&>>(x), cpp11::as_cpp<cpp11::decay_t<const cpp11::doubles_matrix<>&>>(y), cpp11::as_cpp<cpp11::decay_t<const double>>(delta), cpp11::as_cpp<cpp11::decay_t<const double>>(wasserstein_power), cpp11::as_cpp<cpp11::decay_t<const int>>(oracle_type), cpp11::as_cpp<cpp11::decay_t<const bool>>(adaptive_epsilon)));
+  END_CPP11
+}
 // wasserstein.cpp
-double wassersteinDistance(const cpp11::doubles_matrix<>& x, const cpp11::doubles_matrix<>& y, const double delta, const double wasserstein_power);
-extern "C" SEXP _phutil_wassersteinDistance(SEXP x, SEXP y, SEXP delta, SEXP wasserstein_power) {
+double wassersteinDistanceMultiscale(const cpp11::doubles_matrix<>& x, const cpp11::doubles_matrix<>& y, const double delta, const double wasserstein_power, const int oracle_type, const bool adaptive_epsilon);
+extern "C" SEXP _phutil_wassersteinDistanceMultiscale(SEXP x, SEXP y, SEXP delta, SEXP wasserstein_power, SEXP oracle_type, SEXP adaptive_epsilon) {
   BEGIN_CPP11
-    return cpp11::as_sexp(wassersteinDistance(cpp11::as_cpp<cpp11::decay_t<const cpp11::doubles_matrix<>&>>(x), cpp11::as_cpp<cpp11::decay_t<const cpp11::doubles_matrix<>&>>(y), cpp11::as_cpp<cpp11::decay_t<const double>>(delta), cpp11::as_cpp<cpp11::decay_t<const double>>(wasserstein_power)));
+    return cpp11::as_sexp(wassersteinDistanceMultiscale(cpp11::as_cpp<cpp11::decay_t<const cpp11::doubles_matrix<>&>>(x), cpp11::as_cpp<cpp11::decay_t<const cpp11::doubles_matrix<>&>>(y), cpp11::as_cpp<cpp11::decay_t<const double>>(delta), cpp11::as_cpp<cpp11::decay_t<const double>>(wasserstein_power), cpp11::as_cpp<cpp11::decay_t<const int>>(oracle_type), cpp11::as_cpp<cpp11::decay_t<const bool>>(adaptive_epsilon)));
   END_CPP11
 }
 // wasserstein.cpp
-cpp11::doubles wassersteinPairwiseDistances(const cpp11::list& x, const double delta, const double wasserstein_power, const unsigned int ncores);
-extern "C" SEXP _phutil_wassersteinPairwiseDistances(SEXP x, SEXP delta, SEXP wasserstein_power, SEXP ncores) {
+cpp11::doubles wassersteinDistancePruned(const cpp11::doubles_matrix<>& x, const cpp11::doubles_matrix<>& y, const double prune_error_budget, const double delta, const double wasserstein_power, const int oracle_type, const bool adaptive_epsilon);
+extern "C" SEXP _phutil_wassersteinDistancePruned(SEXP x, SEXP y, SEXP prune_error_budget, SEXP delta, SEXP wasserstein_power, SEXP oracle_type, SEXP adaptive_epsilon) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(wassersteinDistancePruned(cpp11::as_cpp<cpp11::decay_t<const cpp11::doubles_matrix<>&>>(x), cpp11::as_cpp<cpp11::decay_t<const cpp11::doubles_matrix<>&>>(y), cpp11::as_cpp<cpp11::decay_t<const double>>(prune_error_budget), cpp11::as_cpp<cpp11::decay_t<const double>>(delta), cpp11::as_cpp<cpp11::decay_t<const double>>(wasserstein_power), cpp11::as_cpp<cpp11::decay_t<const int>>(oracle_type), cpp11::as_cpp<cpp11::decay_t<const bool>>(adaptive_epsilon)));
+  END_CPP11
+}
+// wasserstein.cpp
+cpp11::list wassersteinMatching(const cpp11::doubles_matrix<>& x, const cpp11::doubles_matrix<>& y, const double delta, const double wasserstein_power, const int oracle_type, const bool adaptive_epsilon);
+extern "C" SEXP _phutil_wassersteinMatching(SEXP x, SEXP y, SEXP delta, SEXP wasserstein_power, SEXP oracle_type, SEXP adaptive_epsilon) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(wassersteinMatching(cpp11::as_cpp<cpp11::decay_t<const cpp11::doubles_matrix<>&>>(x), cpp11::as_cpp<cpp11::decay_t<const cpp11::doubles_matrix<>&>>(y), cpp11::as_cpp<cpp11::decay_t<const double>>(delta), cpp11::as_cpp<cpp11::decay_t<const double>>(wasserstein_power), cpp11::as_cpp<cpp11::decay_t<const int>>(oracle_type), cpp11::as_cpp<cpp11::decay_t<const bool>>(adaptive_epsilon)));
+  END_CPP11
+}
+// wasserstein.cpp
+cpp11::list wassersteinDistanceWarmStart(const cpp11::doubles_matrix<>& x, const cpp11::doubles_matrix<>& y, const cpp11::list& warm_start, const double delta, const double wasserstein_power, const bool adaptive_epsilon);
+extern "C" SEXP _phutil_wassersteinDistanceWarmStart(SEXP x, SEXP y, SEXP warm_start, SEXP delta, SEXP wasserstein_power, SEXP adaptive_epsilon) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(wassersteinDistanceWarmStart(cpp11::as_cpp<cpp11::decay_t<const cpp11::doubles_matrix<>&>>(x), cpp11::as_cpp<cpp11::decay_t<const cpp11::doubles_matrix<>&>>(y), cpp11::as_cpp<cpp11::decay_t<const cpp11::list&>>(warm_start), cpp11::as_cpp<cpp11::decay_t<const double>>(delta), cpp11::as_cpp<cpp11::decay_t<const double>>(wasserstein_power), cpp11::as_cpp<cpp11::decay_t<const bool>>(adaptive_epsilon)));
+  END_CPP11
+}
+// wasserstein.cpp
+cpp11::doubles wassersteinStreamDistances(const cpp11::list& x, const double delta, const double wasserstein_power, const int lag);
+extern "C" SEXP _phutil_wassersteinStreamDistances(SEXP x, SEXP delta, SEXP wasserstein_power, SEXP lag) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(wassersteinStreamDistances(cpp11::as_cpp<cpp11::decay_t<const cpp11::list&>>(x), cpp11::as_cpp<cpp11::decay_t<const double>>(delta), cpp11::as_cpp<cpp11::decay_t<const double>>(wasserstein_power), cpp11::as_cpp<cpp11::decay_t<const int>>(lag)));
+  END_CPP11
+}
+// wasserstein.cpp
+cpp11::doubles wassersteinPairwiseDistances(const cpp11::list& x, const double delta, const double wasserstein_power, const double prune_error_budget, const int oracle_type, const bool adaptive_epsilon, const unsigned int ncores);
+extern "C" SEXP _phutil_wassersteinPairwiseDistances(SEXP x, SEXP delta, SEXP wasserstein_power, SEXP prune_error_budget, SEXP oracle_type, SEXP adaptive_epsilon, SEXP ncores) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(wassersteinPairwiseDistances(cpp11::as_cpp<cpp11::decay_t<const cpp11::list&>>(x), cpp11::as_cpp<cpp11::decay_t<const double>>(delta), cpp11::as_cpp<cpp11::decay_t<const double>>(wasserstein_power), cpp11::as_cpp<cpp11::decay_t<const double>>(prune_error_budget), cpp11::as_cpp<cpp11::decay_t<const int>>(oracle_type), cpp11::as_cpp<cpp11::decay_t<const bool>>(adaptive_epsilon), cpp11::as_cpp<cpp11::decay_t<const unsigned int>>(ncores)));
+  END_CPP11
+}
+// wasserstein_point_cloud.cpp
+double pointCloudWassersteinDistance(const cpp11::doubles_matrix<>& x, const cpp11::doubles_matrix<>& y, const double delta, const double wasserstein_power, const double internal_p, const double deletion_cost, const int max_bids_per_round);
+extern "C" SEXP _phutil_pointCloudWassersteinDistance(SEXP x, SEXP y, SEXP delta, SEXP wasserstein_power, SEXP internal_p, SEXP deletion_cost, SEXP max_bids_per_round) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(pointCloudWassersteinDistance(cpp11::as_cpp<cpp11::decay_t<const cpp11::doubles_matrix<>&>>(x), cpp11::as_cpp<cpp11::decay_t<const cpp11::doubles_matrix<>&>>(y), cpp11::as_cpp<cpp11::decay_t<const double>>(delta), cpp11::as_cpp<cpp11::decay_t<const double>>(wasserstein_power), cpp11::as_cpp<cpp11::decay_t<const double>>(internal_p), cpp11::as_cpp<cpp11::decay_t<const double>>(deletion_cost), cpp11::as_cpp<cpp11::decay_t<const int>>(max_bids_per_round)));
+  END_CPP11
+}
+// wasserstein_point_cloud.cpp
+cpp11::doubles pointCloudWassersteinPairwiseDistances(const cpp11::list& x, const double delta, const double wasserstein_power, const double internal_p, const double deletion_cost, const unsigned int ncores);
+extern "C" SEXP _phutil_pointCloudWassersteinPairwiseDistances(SEXP x, SEXP delta, SEXP wasserstein_power, SEXP internal_p, SEXP deletion_cost, SEXP ncores) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(pointCloudWassersteinPairwiseDistances(cpp11::as_cpp<cpp11::decay_t<const cpp11::list&>>(x), cpp11::as_cpp<cpp11::decay_t<const double>>(delta), cpp11::as_cpp<cpp11::decay_t<const double>>(wasserstein_power), cpp11::as_cpp<cpp11::decay_t<const double>>(internal_p), cpp11::as_cpp<cpp11::decay_t<const double>>(deletion_cost), cpp11::as_cpp<cpp11::decay_t<const unsigned int>>(ncores)));
+  END_CPP11
+}
+// wasserstein_search.cpp
+double wassersteinDistanceLowerBound(const cpp11::doubles_matrix<>& x, const cpp11::doubles_matrix<>& y, const double wasserstein_power, const int num_scales);
+extern "C" SEXP _phutil_wassersteinDistanceLowerBound(SEXP x, SEXP y, SEXP wasserstein_power, SEXP num_scales) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(wassersteinDistanceLowerBound(cpp11::as_cpp<cpp11::decay_t<const cpp11::doubles_matrix<>&>>(x), cpp11::as_cpp<cpp11::decay_t<const cpp11::doubles_matrix<>&>>(y), cpp11::as_cpp<cpp11::decay_t<const double>>(wasserstein_power), cpp11::as_cpp<cpp11::decay_t<const int>>(num_scales)));
+  END_CPP11
+}
+// wasserstein_search.cpp
+cpp11::list wassersteinKnn(const cpp11::list& x, const cpp11::list& y, const int k, const double delta, const double wasserstein_power, const unsigned int ncores);
+extern "C" SEXP _phutil_wassersteinKnn(SEXP x, SEXP y, SEXP k, SEXP delta, SEXP wasserstein_power, SEXP ncores) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(wassersteinKnn(cpp11::as_cpp<cpp11::decay_t<const cpp11::list&>>(x), cpp11::as_cpp<cpp11::decay_t<const cpp11::list&>>(y), cpp11::as_cpp<cpp11::decay_t<const int>>(k), cpp11::as_cpp<cpp11::decay_t<const double>>(delta), cpp11::as_cpp<cpp11::decay_t<const double>>(wasserstein_power), cpp11::as_cpp<cpp11::decay_t<const unsigned int>>(ncores)));
+  END_CPP11
+}
+// wasserstein_search.cpp
+cpp11::list wassersteinRangeSearch(const cpp11::list& x, const cpp11::list& y, const double radius, const double delta, const double wasserstein_power, const unsigned int ncores);
+extern "C" SEXP _phutil_wassersteinRangeSearch(SEXP x, SEXP y, SEXP radius, SEXP delta, SEXP wasserstein_power, SEXP ncores) {
   BEGIN_CPP11
-    return cpp11::as_sexp(wassersteinPairwiseDistances(cpp11::as_cpp<cpp11::decay_t<const cpp11::list&>>(x), cpp11::as_cpp<cpp11::decay_t<const double>>(delta), cpp11::as_cpp<cpp11::decay_t<const double>>(wasserstein_power), cpp11::as_cpp<cpp11::decay_t<const unsigned int>>(ncores)));
+    return cpp11::as_sexp(wassersteinRangeSearch(cpp11::as_cpp<cpp11::decay_t<const cpp11::list&>>(x), cpp11::as_cpp<cpp11::decay_t<const cpp11::list&>>(y), cpp11::as_cpp<cpp11::decay_t<const double>>(radius), cpp11::as_cpp<cpp11::decay_t<const double>>(delta), cpp11::as_cpp<cpp11::decay_t<const double>>(wasserstein_power), cpp11::as_cpp<cpp11::decay_t<const unsigned int>>(ncores)));
   END_CPP11
 }
 
 extern "C" {
 static const R_CallMethodDef CallEntries[] = {
-    {"_phutil_bottleneckDistance",           (DL_FUNC) &_phutil_bottleneckDistance,           3},
-    {"_phutil_bottleneckPairwiseDistances",  (DL_FUNC) &_phutil_bottleneckPairwiseDistances,  3},
-    {"_phutil_wassersteinDistance",          (DL_FUNC) &_phutil_wassersteinDistance,          4},
-    {"_phutil_wassersteinPairwiseDistances", (DL_FUNC) &_phutil_wassersteinPairwiseDistances, 4},
+    {"_phutil_bottleneckDistance",                     (DL_FUNC) &_phutil_bottleneckDistance,                     3},
+    {"_phutil_bottleneckPairwiseDistances",            (DL_FUNC) &_phutil_bottleneckPairwiseDistances,            3},
+    {"_phutil_diagramIndexBuild",                      (DL_FUNC) &_phutil_diagramIndexBuild,                      6},
+    {"_phutil_diagramIndexKnn",                        (DL_FUNC) &_phutil_diagramIndexKnn,                        4},
+    {"_phutil_diagramIndexRange",                      (DL_FUNC) &_phutil_diagramIndexRange,                      4},
+    {"_phutil_pointCloudWassersteinDistance",          (DL_FUNC) &_phutil_pointCloudWassersteinDistance,          7},
+    {"_phutil_pointCloudWassersteinPairwiseDistances", (DL_FUNC) &_phutil_pointCloudWassersteinPairwiseDistances, 6},
+    {"_phutil_setKdTreeThreads",                       (DL_FUNC) &_phutil_setKdTreeThreads,                       1},
+    {"_phutil_sinkhornPairwiseDistances",              (DL_FUNC) &_phutil_sinkhornPairwiseDistances,              6},
+    {"_phutil_slicedWassersteinCrossDistances",        (DL_FUNC) &_phutil_slicedWassersteinCrossDistances,        4},
+    {"_phutil_slicedWassersteinPairwiseDistances",     (DL_FUNC) &_phutil_slicedWassersteinPairwiseDistances,     3},
+    {"_phutil_syntheticDiagramMatrix",                 (DL_FUNC) &_phutil_syntheticDiagramMatrix,                 8},
+    {"_phutil_wassersteinBarycenter",                  (DL_FUNC) &_phutil_wassersteinBarycenter,                  6},
+    {"_phutil_wassersteinDistance",                    (DL_FUNC) &_phutil_wassersteinDistance,                    6},
+    {"_phutil_wassersteinDistanceLowerBound",          (DL_FUNC) &_phutil_wassersteinDistanceLowerBound,          4},
+    {"_phutil_wassersteinDistanceMultiscale",          (DL_FUNC) &_phutil_wassersteinDistanceMultiscale,          6},
+    {"_phutil_wassersteinDistancePruned",              (DL_FUNC) &_phutil_wassersteinDistancePruned,              7},
+    {"_phutil_wassersteinDistanceWarmStart",           (DL_FUNC) &_phutil_wassersteinDistanceWarmStart,           6},
+    {"_phutil_wassersteinKnn",                         (DL_FUNC) &_phutil_wassersteinKnn,                         6},
+    {"_phutil_wassersteinMatching",                    (DL_FUNC) &_phutil_wassersteinMatching,                    6},
+    {"_phutil_wassersteinPairwiseDistances",           (DL_FUNC) &_phutil_wassersteinPairwiseDistances,           7},
+    {"_phutil_wassersteinRangeSearch",                 (DL_FUNC) &_phutil_wassersteinRangeSearch,                 6},
+    {"_phutil_wassersteinStreamDistances",             (DL_FUNC) &_phutil_wassersteinStreamDistances,             4},
     {NULL, NULL, 0}
 };
 }
@@ -0,0 +1,367 @@
+#include "diagram_index.h"
+#include "diagram_parser.h"
+#include "hera/bottleneck.h"
+#include "hera/wasserstein.h"
+
+#include <algorithm>
+#include <limits>
+#include <queue>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace
+{
+
+size_t middle(size_t lo, size_t hi)
+{
+  return lo + 1 + (hi - lo - 1) / 2;
+}
+
+// The k best so far, the farthest on top.
+struct KnnVisit
+{
+  size_t k;
+  std::priority_queue<std::pair<double,size_t>> best;
+
+  double bound() const
+  {
+    return best.size() < k ? std::numeric_limits<double>::infinity() : best.top().first;
+  }
+
+  void add(size_t j, double d)
+  {
+    if (best.size() < k)
+      best.emplace(d, j);
+    else if (d < best.top().first)
+    {
+      best.pop();
+      best.emplace(d, j);
+    }
+  }
+};
+
+struct RangeVisit
+{
+  double radius;
+  DiagramIndex::Neighbours result;
+
+  double bound() const { return radius; }
+
+  void add(size_t j, double d)
+  {
+    if (d <= radius)
+      result.emplace_back(j, d);
+  }
+};
+
+}
+
+DiagramIndex::DiagramIndex(const std::vector<Diagram>& diagrams,
+                           const Params& params,
+                           std::vector<int> order,
+                           unsigned int ncores) :
+  diagrams_(diagrams),
+  params_(params),
+  order_(std::move(order)),
+  inner_(order_.size(), 0.0),
+  outer_(order_.size(), std::numeric_limits<double>::infinity())
+{
+  build(0, order_.size(), ncores);
+}
+
+DiagramIndex::DiagramIndex(const std::vector<Diagram>& diagrams,
+                           const Params& params,
+                           std::vector<int> order,
+                           std::vector<double> inner,
+                           std::vector<double> outer) :
+  diagrams_(diagrams),
+  params_(params),
+  order_(std::move(order)),
+  inner_(std::move(inner)),
+  outer_(std::move(outer))
+{
+}
+
+double DiagramIndex::distance(const Diagram& a, const Diagram& b) const
+{
+  if (params_.metric == Metric::bottleneck)
+  {
+    if (params_.delta > 0.0)
+      return hera::bottleneckDistApprox(a, b, params_.delta);
+    int decPrecision { 0 };
+    return hera::bottleneckDistExact(a, b, decPrecision);
+  }
+
+  hera::AuctionParams<double> params;
+  params.wasserstein_power = params_.wasserstein_power;
+  params.delta = params_.delta;
+  params.adaptive_epsilon = true;
+  params.remove_duplicates = params.wasserstein_power == 1.0;
+  return hera::wasserstein_cost_detailed(a, b, params).distance;
+}
+
+void DiagramIndex::build(size_t lo, size_t hi, unsigned int ncores)
+{
+  if (hi - lo < 2)
+    return;
+
+  const Diagram& vantage = diagrams_[order_[lo]];
+  const int n = hi - lo - 1;
+  // distance and diagram
+  std::vector<std::pair<double,int>> distances(n);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(ncores) schedule(dynamic) if(n > 1)
+#endif
+  for (int i = 0;i < n;++i)
+    distances[i] = std::make_pair(distance(vantage, diagrams_[order_[lo + 1 + i]]), order_[lo + 1 + i]);
+  num_build_distances_ += n;
+
+  const size_t mid = middle(lo, hi), m = mid - lo - 1;
+  std::nth_element(distances.begin(), distances.begin() + m, distances.end());
+  for (int i = 0;i < n;++i)
+    order_[lo + 1 + i] = distances[i].second;
+  if (m > 0)
+    inner_[lo] = std::max_element(distances.begin(), distances.begin() + m)->first;
+  outer_[lo] = distances[m].first;
+
+  build(lo + 1, mid, ncores);
+  build(mid, hi, ncores);
+}
+
+template<class Visit>
+void DiagramIndex::search(const Diagram& query, size_t lo, size_t hi, Visit& visit, int& num_distances) const
+{
+  if (lo >= hi)
+    return;
+
+  const double d = distance(query, diagrams_[order_[lo]]);
+  ++num_distances;
+  visit.add(order_[lo], d);
+
+  // lower bounds on the true distances to the diagrams of either side
+  const size_t mid = middle(lo, hi);
+  const double scale = 1.0 + params_.delta;
+  const double inside = d / scale - inner_[lo];
+  const double outside = outer_[lo] / scale - d;
+
+  if (inside <= outside)
+  {
+    if (mid > lo + 1 && inside <= visit.bound())
+      search(query, lo + 1, mid, visit, num_distances);
+    if (hi > mid && outside <= visit.bound())
+      search(query, mid, hi, visit, num_distances);
+  }
+  else
+  {
+    if (hi > mid && outside <= visit.bound())
+      search(query, mid, hi, visit, num_distances);
+    if (mid > lo + 1 && inside <= visit.bound())
+      search(query, lo + 1, mid, visit, num_distances);
+  }
+}
+
+DiagramIndex::Neighbours DiagramIndex::knn(const Diagram& query, size_t k, int& num_distances) const
+{
+  KnnVisit visit {std::min(k, diagrams_.size()), {}};
+  if (visit.k == 0)
+    return {};
+  search(query, 0, order_.size(), visit, num_distances);
+
+  Neighbours result(visit.best.size());
+  for (size_t i = result.size();i-- > 0;)
+  {
+    result[i] = std::make_pair(visit.best.top().second, visit.best.top().first);
+    visit.best.pop();
+  }
+  return result;
+}
+
+DiagramIndex::Neighbours DiagramIndex::range(const Diagram& query, double radius, int& num_distances) const
+{
+  RangeVisit visit {radius, {}};
+  search(query, 0, order_.size(), visit, num_distances);
+
+  std::sort(visit.result.begin(), visit.result.end(),
+            [](const std::pair<size_t,double>& a, const std::pair<size_t,double>& b) {
+              return a.second < b.second;
+            });
+  return visit.result;
+}
+
+std::vector<PairVector> indexDiagrams(const cpp11::list& x)
+{
+  std::vector<PairVector> result(x.size());
+  for (int n = 0;n < x.size();++n)
+    parseMatrix(cpp11::as_cpp<cpp11::doubles_matrix<>>(x[n]), result[n]);
+  return result;
+}
+
+DiagramIndex::Params indexParams(const int metric,
+                                 const double delta,
+                                 const double wasserstein_power)
+{
+  DiagramIndex::Params params;
+  params.metric = static_cast<DiagramIndex::Metric>(metric);
+  params.delta = delta;
+  params.wasserstein_power = wasserstein_power;
+  if (params.metric == DiagramIndex::Metric::wasserstein)
+  {
+    if (params.wasserstein_power < 1.0)
+      cpp11::stop("Wasserstein_degree must be a number >= 1.0. Cannot proceed.");
+    if (params.delta <= 0.0)
+      cpp11::stop("relative error must be a number > 0.0. Cannot proceed.");
+  }
+  else if (params.delta < 0.0)
+    cpp11::stop("relative error must be a number >= 0.0. Cannot proceed.");
+  return params;
+}
+
+// An index read back from R may have been edited: the search trusts the
+// permutation and the radii, so they are checked against the diagrams first.
+DiagramIndex restoreIndex(const cpp11::list& index)
+{
+  const cpp11::list diagrams(index["diagrams"]);
+  const cpp11::integers order(index["order"]);
+  const cpp11::doubles inner(index["inner"]), outer(index["outer"]);
+  const int n = diagrams.size();
+  if (order.size() != n || inner.size() != n || outer.size() != n)
+    cpp11::stop("the index is corrupted: order, inner and outer must have one element per diagram.");
+  std::vector<bool> seen(n, false);
+  for (int i : order)
+  {
+    if (i == NA_INTEGER || i < 0 || i >= n || seen[i])
+      cpp11::stop("the index is corrupted: order must be a permutation of the diagrams.");
+    seen[i] = true;
+  }
+  for (int i = 0;i < n;++i)
+  {
+    if (cpp11::as_cpp<cpp11::doubles_matrix<>>(diagrams[i]).ncol() != 2)
+      cpp11::stop("the index is corrupted: diagrams must be matrices with 2 columns.");
+  }
+  const int metric = cpp11::as_cpp<int>(index["metric_type"]);
+  if (metric != 0 && metric != 1)
+    cpp11::stop("the index is corrupted: unknown metric.");
+
+  return DiagramIndex(indexDiagrams(diagrams),
+                      indexParams(metric,
+                                  cpp11::as_cpp<double>(index["tol"]),
+                                  cpp11::as_cpp<double>(index["p"])),
+                      std::vector<int>(order.begin(), order.end()),
+                      std::vector<double>(inner.begin(), inner.end()),
+                      std::vector<double>(outer.begin(), outer.end()));
+}
+
+// Vantage-point tree over the diagrams of x, the vantage points taken in the
+// order of the 0-based permutation `order`.
+[[cpp11::register]]
+cpp11::list diagramIndexBuild(const cpp11::list& x,
+                              const cpp11::integers& order,
+                              const int metric_type = 1,
+                              const double delta = 0.01,
+                              const double wasserstein_power = 1.0,
+                              const unsigned int ncores = 1)
+{
+  using namespace cpp11::literals;
+
+  const DiagramIndex index(indexDiagrams(x),
+                           indexParams(metric_type, delta, wasserstein_power),
+                           std::vector<int>(order.begin(), order.end()),
+                           ncores);
+
+  return cpp11::writable::list({
+    "order"_nm = cpp11::writable::integers(index.order().begin(), index.order().end()),
+    "inner"_nm = cpp11::writable::doubles(index.inner().begin(), index.inner().end()),
+    "outer"_nm = cpp11::writable::doubles(index.outer().begin(), index.outer().end()),
+    "num_distances"_nm = index.num_build_distances()
+  });
+}
+
+// The k nearest indexed diagrams to every diagram of x, as matrices of
+// 1-based indices and distances with one row per query, and the number of
+// distances computed for each query.
+[[cpp11::register]]
+cpp11::list diagramIndexKnn(const cpp11::list& index,
+                            const cpp11::list& x,
+                            const int k = 1,
+                            const unsigned int ncores = 1)
+{
+  using namespace cpp11::literals;
+
+  const DiagramIndex tree = restoreIndex(index);
+  const auto queries = indexDiagrams(x);
+
+  const int N = queries.size();
+  std::vector<DiagramIndex::Neighbours> neighbours(N);
+  std::vector<int> num_distances(N, 0);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(ncores) schedule(dynamic)
+#endif
+  for (int i = 0;i < N;++i)
+    neighbours[i] = tree.knn(queries[i], k, num_distances[i]);
+
+  const int K = std::min<size_t>(k, tree.size());
+  cpp11::writable::integers_matrix<> indices(N, K);
+  cpp11::writable::doubles_matrix<> distances(N, K);
+  for (int i = 0;i < N;++i)
+  {
+    for (int j = 0;j < K;++j)
+    {
+      indices(i, j) = neighbours[i][j].first + 1;
+      distances(i, j) = neighbours[i][j].second;
+    }
+  }
+
+  return cpp11::writable::list({
+    "index"_nm = indices,
+    "distance"_nm = distances,
+    "num_distances"_nm = cpp11::writable::integers(num_distances.begin(), num_distances.end())
+  });
+}
+
+// The indexed diagrams within radius of every diagram of x, as a list with
+// one list(index, distance) per query, and the number of distances computed
+// for each query.
+[[cpp11::register]]
+cpp11::list diagramIndexRange(const cpp11::list& index,
+                              const cpp11::list& x,
+                              const double radius,
+                              const unsigned int ncores = 1)
+{
+  using namespace cpp11::literals;
+
+  const DiagramIndex tree = restoreIndex(index);
+  const auto queries = indexDiagrams(x);
+
+  const int N = queries.size();
+  std::vector<DiagramIndex::Neighbours> neighbours(N);
+  std::vector<int> num_distances(N, 0);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(ncores) schedule(dynamic)
+#endif
+  for (int i = 0;i < N;++i)
+    neighbours[i] = tree.range(queries[i], radius, num_distances[i]);
+
+  cpp11::writable::list matches(N);
+  for (int i = 0;i < N;++i)
+  {
+    const int M = neighbours[i].size();
+    cpp11::writable::integers index(M);
+    cpp11::writable::doubles distance(M);
+    for (int j = 0;j < M;++j)
+    {
+      index[j] = neighbours[i][j].first + 1;
+      distance[j] = neighbours[i][j].second;
+    }
+    matches[i] = cpp11::writable::list({
+      "index"_nm = index,
+      "distance"_nm = distance
+    });
+  }
+
+  return cpp11::writable::list({
+    "matches"_nm = matches,
+    "num_distances"_nm = cpp11::writable::integers(num_distances.begin(), num_distances.end())
+  });
+}
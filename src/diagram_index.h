@@ -0,0 +1,77 @@
+#ifndef PHUTIL_DIAGRAM_INDEX_H
+#define PHUTIL_DIAGRAM_INDEX_H
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Vantage-point tree over persistence diagrams for the bottleneck or the
+// Wasserstein distance. The tree is implicit in a permutation of the
+// diagrams: the node over positions [lo, hi) has its vantage point at lo,
+// the diagrams of positions [lo + 1, mid) closer to it than those of [mid,
+// hi), mid = lo + 1 + (hi - lo - 1) / 2, and keeps the largest distance
+// inside and the smallest distance outside. A tree is thus stored as three
+// vectors and can be restored without any distance computation.
+//
+// The distances are computed to a relative error delta, overestimating the
+// true ones by a factor of at most 1 + delta, and the triangle inequality is
+// applied to the true distances they bound, so that the pruned subtrees are
+// certified to hold no better neighbours.
+class DiagramIndex
+{
+public:
+  using Diagram = std::vector<std::pair<double,double>>;
+  // diagram and distance
+  using Neighbours = std::vector<std::pair<size_t,double>>;
+
+  enum class Metric { bottleneck, wasserstein };
+
+  struct Params
+  {
+    Metric metric {Metric::wasserstein};
+    double wasserstein_power {1.0};
+    double delta {0.01};
+  };
+
+  // Builds the tree with the vantage points taken in the order of
+  // `order`, a permutation of the diagrams; the distances of each node are
+  // computed in parallel.
+  DiagramIndex(const std::vector<Diagram>& diagrams,
+               const Params& params,
+               std::vector<int> order,
+               unsigned int ncores = 1);
+  // Restores a tree from the vectors of a built one.
+  DiagramIndex(const std::vector<Diagram>& diagrams,
+               const Params& params,
+               std::vector<int> order,
+               std::vector<double> inner,
+               std::vector<double> outer);
+
+  size_t size() const { return diagrams_.size(); }
+  const std::vector<int>& order() const { return order_; }
+  const std::vector<double>& inner() const { return inner_; }
+  const std::vector<double>& outer() const { return outer_; }
+  int num_build_distances() const { return num_build_distances_; }
+
+  double distance(const Diagram& a, const Diagram& b) const;
+
+  // k nearest diagrams, by increasing distance
+  Neighbours knn(const Diagram& query, size_t k, int& num_distances) const;
+  // diagrams within radius, by increasing distance
+  Neighbours range(const Diagram& query, double radius, int& num_distances) const;
+
+private:
+  void build(size_t lo, size_t hi, unsigned int ncores);
+
+  template<class Visit>
+  void search(const Diagram& query, size_t lo, size_t hi, Visit& visit, int& num_distances) const;
+
+  std::vector<Diagram> diagrams_;
+  Params params_;
+  std::vector<int> order_;
+  std::vector<double> inner_;
+  std::vector<double> outer_;
+  int num_build_distances_ {0};
+};
+
+#endif // PHUTIL_DIAGRAM_INDEX_H
@@ -6,6 +6,7 @@
 #include <boost/iterator/iterator_facade.hpp>
 #include <boost/serialization/access.hpp>
 #include <boost/serialization/vector.hpp>
+#include <cassert>
 #include <cmath>
 
 #include "../../common/infinity.h"
@@ -17,40 +18,38 @@ namespace ws
 namespace dnn
 {
 
+// Points of a dimension chosen at run time. The dimension and the point ids
+// belong to the container, and the coordinates are stored axis by axis: the
+// coordinates along axis a start at axis(a), stride() apart from the ones
+// along the next axis. No state is shared between containers, so that
+// computations on point clouds of different dimensions may run concurrently.
 template<class Real_>
 class DynamicPointVector
 {
     public:
         using Real = Real_;
+
+        // a view of the point of a container, invalidated when the container
+        // grows
         struct PointType
         {
-            void* p;
-
-            Real& operator[](const int i)
-            {
-                return (static_cast<Real*>(p))[i];
-            }
+            Real*   p;
+            size_t  stride;
+            size_t* id;
 
-            const Real& operator[](const int i) const
-            {
-                return (static_cast<Real*>(p))[i];
-            }
-
-            // TODO: fix to return matching for point clouds
-            // unreliable hack for now: traits will set static member dim here
-            size_t get_id() const { return *((size_t*) ((Real*)(p) + dim)); }
+            Real&           operator[](const int i)                     { return p[i * stride]; }
+            const Real&     operator[](const int i) const               { return p[i * stride]; }
 
-            static unsigned dim;
+            size_t          get_id() const                              { return *id; }
         };
         struct iterator;
         typedef             iterator                                    const_iterator;
 
     public:
-                            DynamicPointVector(size_t point_capacity = 0):
-                                point_capacity_(point_capacity)         {}
-
+                            DynamicPointVector(unsigned dim = 0):
+                                dim_(dim)                               {}
 
-        PointType           operator[](size_t i) const                  { return {(void*) &storage_[i*point_capacity_]}; }
+        PointType           operator[](size_t i) const;
         inline void         push_back(PointType p);
 
         inline iterator         begin();
@@ -58,46 +57,48 @@ class DynamicPointVector
         inline const_iterator   begin() const;
         inline const_iterator   end() const;
 
-        size_t              size() const                                { return storage_.size() / point_capacity_; }
+        unsigned            dimension() const                           { return dim_; }
+        size_t              size() const                                { return ids_.size(); }
+        bool                empty() const                               { return ids_.empty(); }
+        size_t              stride() const                              { return stride_; }
 
-        void                clear()                                     { storage_.clear(); }
-        void                swap(DynamicPointVector& other)             { storage_.swap(other.storage_); std::swap(point_capacity_, other.point_capacity_); }
-        void                reserve(size_t sz)                          { storage_.reserve(sz * point_capacity_); }
-        void                resize(size_t sz)                           { storage_.resize(sz * point_capacity_); }
+        Real*               axis(unsigned a)                            { return coordinates_.data() + a * stride_; }
+        const Real*         axis(unsigned a) const                      { return coordinates_.data() + a * stride_; }
+        Real&               coordinate(size_t i, unsigned a)            { return coordinates_[a * stride_ + i]; }
+        const Real&         coordinate(size_t i, unsigned a) const      { return coordinates_[a * stride_ + i]; }
+        size_t&             id(size_t i)                                { return ids_[i]; }
+        const size_t&       id(size_t i) const                          { return ids_[i]; }
+
+        void                clear()                                     { ids_.clear(); }
+        void                swap(DynamicPointVector& other);
+        void                reserve(size_t sz);
+        // new points are at the origin, with their index as id
+        void                resize(size_t sz);
 
     private:
-        size_t              point_capacity_;
-        std::vector<char>   storage_;
+        unsigned            dim_;
+        size_t              stride_ { 0 };                              // capacity of an axis
+        std::vector<Real>   coordinates_;                               // coordinates_[a * stride_ + i]
+        std::vector<size_t> ids_;
 
     private:
         friend  class   boost::serialization::access;
 
         template<class Archive>
-        void serialize(Archive& ar, const unsigned int version)         { ar & point_capacity_ & storage_; }
+        void serialize(Archive& ar, const unsigned int version)         { ar & dim_ & stride_ & coordinates_ & ids_; }
 };
 
-template<class Real_>
-unsigned DynamicPointVector<Real_>::PointType::dim = 0;
-
 template<typename Real>
 struct DynamicPointTraits
 {
     typedef         DynamicPointVector<Real>                            PointContainer;
     typedef         typename PointContainer::PointType                  PointType;
-    struct PointHandle
-    {
-        void* p;
-        bool        operator==(const PointHandle& other) const          { return p == other.p; }
-        bool        operator!=(const PointHandle& other) const          { return !(*this == other); }
-        bool        operator<(const PointHandle& other) const           { return p < other.p; }
-        bool        operator>(const PointHandle& other) const           { return p > other.p; }
-    };
 
     typedef         Real                                                Coordinate;
     typedef         Real                                                DistanceType;
 
-                    DynamicPointTraits(unsigned dim = 0):
-                        dim_(dim)                                       { PointType::dim = dim; }
+                    DynamicPointTraits(unsigned dim = 0, Real internal_p = 2.0):
+                        internal_p(internal_p), dim_(dim)               {}
 
     DistanceType    distance(PointType p1, PointType p2) const
         {
@@ -120,34 +121,19 @@ struct DynamicPointTraits
             }
             return result;
         }
-    DistanceType    distance(PointHandle p1, PointHandle p2) const      { return distance(PointType({p1.p}), PointType({p2.p})); }
     DistanceType    sq_distance(PointType p1, PointType p2) const       { Real res = 0; for (unsigned i = 0; i < dimension(); ++i) { Real c1 = coordinate(p1,i), c2 = coordinate(p2,i); res += (c1 - c2)*(c1 - c2); } return res; }
-    DistanceType    sq_distance(PointHandle p1, PointHandle p2) const   { return sq_distance(PointType({p1.p}), PointType({p2.p})); }
     unsigned        dimension() const                                   { return dim_; }
-    Real&           coordinate(PointType p, unsigned i) const           { return ((Real*) p.p)[i]; }
-    Real&           coordinate(PointHandle h, unsigned i) const         { return ((Real*) h.p)[i]; }
+    Real&           coordinate(PointType p, unsigned i) const           { return p[i]; }
 
     // it's non-standard to return a reference, but we can rely on it for code that assumes this particular point type
-    size_t&         id(PointType p) const                               { return *((size_t*) ((Real*) p.p + dimension())); }
-    size_t&         id(PointHandle h) const                             { return *((size_t*) ((Real*) h.p + dimension())); }
-    PointHandle     handle(PointType p) const                           { return {p.p}; }
-    PointType       point(PointHandle h) const                          { return {h.p}; }
+    size_t&         id(PointType p) const                               { return *p.id; }
 
-    void            swap(PointType p1, PointType p2) const              { std::swap_ranges((char*) p1.p, ((char*) p1.p) + capacity(), (char*) p2.p); }
-    bool            cmp(PointType p1, PointType p2) const               { return std::lexicographical_compare((Real*) p1.p, ((Real*) p1.p) + dimension(), (Real*) p2.p, ((Real*) p2.p) + dimension()); }
-    bool            eq(PointType p1, PointType p2) const                { return std::equal((Real*) p1.p, ((Real*) p1.p) + dimension(), (Real*) p2.p); }
+    bool            cmp(PointType p1, PointType p2) const;
+    bool            eq(PointType p1, PointType p2) const;
 
-    // non-standard, and possibly a weird name
-    size_t          capacity() const                                    { return sizeof(Real)*dimension() + sizeof(size_t); }
-
-    PointContainer  container(size_t n = 0) const                       { PointContainer c(capacity()); c.resize(n); return c; }
+    PointContainer  container(size_t n = 0) const                       { PointContainer c(dimension()); c.resize(n); return c; }
     PointContainer  container(size_t n, const PointType& p) const;
 
-    typename PointContainer::iterator
-                    iterator(PointContainer& c, PointHandle ph) const;
-    typename PointContainer::const_iterator
-                    iterator(const PointContainer& c, PointHandle ph) const;
-
     Real internal_p;
 
     private:
@@ -182,97 +168,132 @@ struct dnn::DynamicPointVector<Real>::iterator:
         typedef     typename Parent::difference_type                difference_type;
         typedef     typename Parent::reference                      reference;
 
-                    iterator(size_t point_capacity = 0):
-                        point_capacity_(point_capacity)             {}
+                    iterator():
+                        c_(nullptr), i_(0)                          {}
 
-                    iterator(void* p, size_t point_capacity):
-                        p_(p), point_capacity_(point_capacity)      {}
+                    iterator(const DynamicPointVector* c, size_t i):
+                        c_(c), i_(i)                                {}
 
     private:
-        void        increment()                                     { p_ = ((char*) p_) + point_capacity_; }
-        void        decrement()                                     { p_ = ((char*) p_) - point_capacity_; }
-        void        advance(difference_type n)                      { p_ = ((char*) p_) + n*point_capacity_; }
+        void        increment()                                     { ++i_; }
+        void        decrement()                                     { --i_; }
+        void        advance(difference_type n)                      { i_ += n; }
         difference_type
-                    distance_to(iterator other) const               { return (((char*) other.p_) - ((char*) p_))/(int) point_capacity_; }
-        bool        equal(const iterator& other) const              { return p_ == other.p_; }
-        reference   dereference() const                             { return {p_}; }
+                    distance_to(iterator other) const               { return static_cast<difference_type>(other.i_) - static_cast<difference_type>(i_); }
+        bool        equal(const iterator& other) const              { return c_ == other.c_ && i_ == other.i_; }
+        reference   dereference() const                             { return (*c_)[i_]; }
 
         friend class ::boost::iterator_core_access;
 
     private:
-        void*       p_;
-        size_t      point_capacity_;
+        const DynamicPointVector*   c_;
+        size_t                      i_;
 };
 
 template<class Real>
-void dnn::DynamicPointVector<Real>::push_back(PointType p)
+typename dnn::DynamicPointVector<Real>::PointType
+dnn::DynamicPointVector<Real>::operator[](size_t i) const
 {
-    if (storage_.capacity() < storage_.size() + point_capacity_)
-        storage_.reserve(1.5*storage_.capacity());
+    // like the points of a std::vector of pointers, a point of a const
+    // container can be written through
+    auto& self = const_cast<DynamicPointVector&>(*this);
+    return { self.coordinates_.data() + i, stride_, &self.ids_[i] };
+}
+
+template<class Real>
+void dnn::DynamicPointVector<Real>::reserve(size_t sz)
+{
+    if (sz <= stride_)
+        return;
+
+    std::vector<Real> coordinates(sz * dim_);
+    for (unsigned a = 0; a < dim_; ++a)
+        std::copy(axis(a), axis(a) + size(), coordinates.begin() + a * sz);
+    coordinates_.swap(coordinates);
+    stride_ = sz;
+    ids_.reserve(sz);
+}
+
+template<class Real>
+void dnn::DynamicPointVector<Real>::resize(size_t sz)
+{
+    size_t old_size = size();
+    if (sz > stride_)
+        reserve(std::max(sz, stride_ + stride_ / 2));
+    for (unsigned a = 0; a < dim_; ++a)
+        for (size_t i = old_size; i < sz; ++i)
+            coordinate(i, a) = 0;
+    ids_.resize(sz);
+    for (size_t i = old_size; i < sz; ++i)
+        ids_[i] = i;
+}
 
-    storage_.resize(storage_.size() + point_capacity_);
+template<class Real>
+void dnn::DynamicPointVector<Real>::push_back(PointType p)
+{
+    size_t i = size();
+    resize(i + 1);
+    for (unsigned a = 0; a < dim_; ++a)
+        coordinate(i, a) = p[a];
+    ids_[i] = p.get_id();
+}
 
-    std::copy((char*) p.p, (char*) p.p + point_capacity_, storage_.end() - point_capacity_);
+template<class Real>
+void dnn::DynamicPointVector<Real>::swap(DynamicPointVector& other)
+{
+    std::swap(dim_, other.dim_);
+    std::swap(stride_, other.stride_);
+    coordinates_.swap(other.coordinates_);
+    ids_.swap(other.ids_);
 }
 
 template<class Real>
-typename dnn::DynamicPointVector<Real>::iterator        dnn::DynamicPointVector<Real>::begin()          { return       iterator((void*) &*storage_.begin(), point_capacity_); }
+typename dnn::DynamicPointVector<Real>::iterator        dnn::DynamicPointVector<Real>::begin()          { return       iterator(this, 0); }
 
 template<class Real>
-typename dnn::DynamicPointVector<Real>::iterator        dnn::DynamicPointVector<Real>::end()            { return       iterator((void*) &*storage_.end(),   point_capacity_); }
+typename dnn::DynamicPointVector<Real>::iterator        dnn::DynamicPointVector<Real>::end()            { return       iterator(this, size()); }
 
 template<class Real>
-typename dnn::DynamicPointVector<Real>::const_iterator  dnn::DynamicPointVector<Real>::begin() const    { return const_iterator((void*) &*storage_.begin(), point_capacity_); }
+typename dnn::DynamicPointVector<Real>::const_iterator  dnn::DynamicPointVector<Real>::begin() const    { return const_iterator(this, 0); }
 
 template<class Real>
-typename dnn::DynamicPointVector<Real>::const_iterator  dnn::DynamicPointVector<Real>::end() const      { return const_iterator((void*) &*storage_.end(),   point_capacity_); }
+typename dnn::DynamicPointVector<Real>::const_iterator  dnn::DynamicPointVector<Real>::end() const      { return const_iterator(this, size()); }
 
 template<typename R>
-typename dnn::DynamicPointTraits<R>::PointContainer
-dnn::DynamicPointTraits<R>::container(size_t n, const PointType& p) const
+bool dnn::DynamicPointTraits<R>::cmp(PointType p1, PointType p2) const
 {
-    PointContainer c = container(n);
-    for (auto x : c)
-        std::copy((char*) p.p, (char*) p.p + capacity(), (char*) x.p);
-    return c;
+    for (unsigned i = 0; i < dimension(); ++i) {
+        if (p1[i] < p2[i])
+            return true;
+        if (p2[i] < p1[i])
+            return false;
+    }
+    return false;
 }
 
 template<typename R>
-typename dnn::DynamicPointTraits<R>::PointContainer::iterator
-dnn::DynamicPointTraits<R>::iterator(PointContainer& c, PointHandle ph) const
-{ return typename PointContainer::iterator(ph.p, capacity()); }
+bool dnn::DynamicPointTraits<R>::eq(PointType p1, PointType p2) const
+{
+    for (unsigned i = 0; i < dimension(); ++i)
+        if (p1[i] != p2[i])
+            return false;
+    return true;
+}
 
 template<typename R>
-typename dnn::DynamicPointTraits<R>::PointContainer::const_iterator
-dnn::DynamicPointTraits<R>::iterator(const PointContainer& c, PointHandle ph) const
-{ return typename PointContainer::const_iterator(ph.p, capacity()); }
+typename dnn::DynamicPointTraits<R>::PointContainer
+dnn::DynamicPointTraits<R>::container(size_t n, const PointType& p) const
+{
+    PointContainer c = container(n);
+    for (size_t i = 0; i < n; ++i) {
+        for (unsigned a = 0; a < dimension(); ++a)
+            c.coordinate(i, a) = p[a];
+        c.id(i) = p.get_id();
+    }
+    return c;
+}
 
 } // ws
 } // hera
 
-namespace std {
-    template<>
-    struct hash<typename hera::ws::dnn::DynamicPointTraits<double>::PointHandle>
-    {
-        using PointHandle = typename hera::ws::dnn::DynamicPointTraits<double>::PointHandle;
-        size_t operator()(const PointHandle& ph) const
-        {
-            return std::hash<void*>()(ph.p);
-        }
-    };
-
-    template<>
-    struct hash<typename hera::ws::dnn::DynamicPointTraits<float>::PointHandle>
-    {
-        using PointHandle = typename hera::ws::dnn::DynamicPointTraits<float>::PointHandle;
-        size_t operator()(const PointHandle& ph) const
-        {
-            return std::hash<void*>()(ph.p);
-        }
-    };
-
-
-} // std
-
-
 #endif
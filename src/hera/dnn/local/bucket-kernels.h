@@ -0,0 +1,208 @@
+#ifndef HERA_DNN_LOCAL_BUCKET_KERNELS_H
+#define HERA_DNN_LOCAL_BUCKET_KERNELS_H
+
+#include <cmath>
+#include <cstddef>
+
+// the explicit kernels are compiled for their instruction sets whatever the
+// flags of the package, and chosen at run time
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define HERA_BUCKET_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+namespace hera
+{
+namespace dnn
+{
+    // Kernels over the points of a kd-tree leaf bucket, stored axis by axis:
+    // the coordinates along axis a of the m points start at
+    // coordinates + a * stride. The distance loops run over the points for
+    // each axis, so that they are vectorized by the compiler; on x86 CPUs
+    // with AVX2 or AVX-512, detected at run time, double precision buckets
+    // use explicit kernels instead. The kernels take the
+    // dimension D as a template argument when it is known at compile time, so
+    // that the loops over the axes are unrolled; D = 0 uses dim.
+
+    enum class Norm { l_inf, l_1, l_2, l_p };
+
+    template<class Real>
+    inline Norm norm_of(Real internal_p)
+    {
+        if (internal_p == Real(-1))             // hera::get_infinity()
+            return Norm::l_inf;
+        if (internal_p == Real(1))
+            return Norm::l_1;
+        if (internal_p == Real(2))
+            return Norm::l_2;
+        return Norm::l_p;
+    }
+
+namespace detail
+{
+    // acc[i] for i in [b, m): the max (l_inf) or the sum (l_1) of the
+    // coordinate differences, or the sum of their squares (l_2) or of their
+    // internal_p-th powers (l_p)
+    template<size_t D, class Real>
+    inline void bucket_accumulate(const Real* coordinates, size_t stride, size_t dim,
+                                  size_t b, size_t m, const Real* q, Norm norm, Real internal_p, Real* acc)
+    {
+        if (D)
+            dim = D;
+        for (size_t i = b; i < m; ++i)
+            acc[i] = 0;
+        for (size_t a = 0; a < dim; ++a)
+        {
+            const Real* x = coordinates + a * stride;
+            const Real qa = q[a];
+            switch (norm)
+            {
+                case Norm::l_inf:
+                    for (size_t i = b; i < m; ++i)
+                    {
+                        Real d = std::fabs(x[i] - qa);
+                        acc[i] = acc[i] < d ? d : acc[i];
+                    }
+                    break;
+                case Norm::l_1:
+                    for (size_t i = b; i < m; ++i)
+                        acc[i] += std::fabs(x[i] - qa);
+                    break;
+                case Norm::l_2:
+                    for (size_t i = b; i < m; ++i)
+                        acc[i] += (x[i] - qa) * (x[i] - qa);
+                    break;
+                case Norm::l_p:
+                    for (size_t i = b; i < m; ++i)
+                        acc[i] += std::pow(std::fabs(x[i] - qa), internal_p);
+                    break;
+            }
+        }
+    }
+
+    // the number of leading points accumulated, a multiple of the SIMD width
+    template<size_t D, class Real>
+    inline size_t bucket_accumulate_simd(const Real*, size_t, size_t, size_t, const Real*, Norm, Real*)
+    {
+        return 0;
+    }
+
+#ifdef HERA_BUCKET_KERNELS_X86
+    enum class SimdLevel { none, avx2, avx512 };
+
+    inline SimdLevel simd_level()
+    {
+        static const SimdLevel level =
+            __builtin_cpu_supports("avx512f") ? SimdLevel::avx512 :
+            __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") ? SimdLevel::avx2 :
+            SimdLevel::none;
+        return level;
+    }
+
+    template<size_t D>
+    __attribute__((target("avx512f")))
+    size_t bucket_accumulate_avx512(const double* coordinates, size_t stride, size_t dim,
+                                    size_t m, const double* q, Norm norm, double* acc)
+    {
+        if (D)
+            dim = D;
+        size_t i = 0;
+        for (; i + 8 <= m; i += 8)
+        {
+            __m512d s = _mm512_setzero_pd();
+            for (size_t a = 0; a < dim; ++a)
+            {
+                __m512d d = _mm512_sub_pd(_mm512_loadu_pd(coordinates + a * stride + i), _mm512_set1_pd(q[a]));
+                // the zero-masked max, whose plain version reads an
+                // undefined register that GCC warns about
+                if (norm == Norm::l_inf)
+                    s = _mm512_maskz_max_pd(0xFF, s, _mm512_abs_pd(d));
+                else if (norm == Norm::l_1)
+                    s = _mm512_add_pd(s, _mm512_abs_pd(d));
+                else
+                    s = _mm512_fmadd_pd(d, d, s);
+            }
+            _mm512_storeu_pd(acc + i, s);
+        }
+        return i;
+    }
+
+    template<size_t D>
+    __attribute__((target("avx2,fma")))
+    size_t bucket_accumulate_avx2(const double* coordinates, size_t stride, size_t dim,
+                                  size_t m, const double* q, Norm norm, double* acc)
+    {
+        if (D)
+            dim = D;
+        const __m256d sign = _mm256_set1_pd(-0.0);
+        size_t i = 0;
+        for (; i + 4 <= m; i += 4)
+        {
+            __m256d s = _mm256_setzero_pd();
+            for (size_t a = 0; a < dim; ++a)
+            {
+                __m256d d = _mm256_sub_pd(_mm256_loadu_pd(coordinates + a * stride + i), _mm256_set1_pd(q[a]));
+                if (norm == Norm::l_inf)
+                    s = _mm256_max_pd(s, _mm256_andnot_pd(sign, d));
+                else if (norm == Norm::l_1)
+                    s = _mm256_add_pd(s, _mm256_andnot_pd(sign, d));
+                else
+                    s = _mm256_fmadd_pd(d, d, s);
+            }
+            _mm256_storeu_pd(acc + i, s);
+        }
+        return i;
+    }
+
+    template<size_t D>
+    inline size_t bucket_accumulate_simd(const double* coordinates, size_t stride, size_t dim,
+                                         size_t m, const double* q, Norm norm, double* acc)
+    {
+        if (norm == Norm::l_p)
+            return 0;
+        switch (simd_level())
+        {
+            case SimdLevel::avx512:
+                return bucket_accumulate_avx512<D>(coordinates, stride, dim, m, q, norm, acc);
+            case SimdLevel::avx2:
+                return bucket_accumulate_avx2<D>(coordinates, stride, dim, m, q, norm, acc);
+            default:
+                return 0;
+        }
+    }
+#endif
+} // detail
+
+    // out[i] = |q - p_i|^power + weights[i] for the m points of a bucket,
+    // the distance being the norm of internal_p
+    template<size_t D = 0, class Real>
+    inline void bucket_values(const Real* coordinates, size_t stride, size_t dim, const Real* weights, size_t m,
+                              const Real* q, Norm norm, Real internal_p, Real power, Real* out)
+    {
+        size_t b = detail::bucket_accumulate_simd<D>(coordinates, stride, dim, m, q, norm, out);
+        detail::bucket_accumulate<D>(coordinates, stride, dim, b, m, q, norm, internal_p, out);
+
+        // the l_2 and l_p sums are distances raised to internal_p
+        Real exponent = power;
+        if (norm == Norm::l_2)
+            exponent = power / 2;
+        else if (norm == Norm::l_p)
+            exponent = power / internal_p;
+
+        if (exponent == Real(1))
+            for (size_t i = 0; i < m; ++i)
+                out[i] += weights[i];
+        else if (exponent == Real(2))
+            for (size_t i = 0; i < m; ++i)
+                out[i] = out[i] * out[i] + weights[i];
+        else if (exponent == Real(0.5))
+            for (size_t i = 0; i < m; ++i)
+                out[i] = std::sqrt(out[i]) + weights[i];
+        else
+            for (size_t i = 0; i < m; ++i)
+                out[i] = std::pow(out[i], exponent) + weights[i];
+    }
+} // dnn
+} // hera
+
+#endif
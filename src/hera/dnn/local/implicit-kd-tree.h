@@ -0,0 +1,104 @@
+#ifndef HERA_WS_DNN_LOCAL_IMPLICIT_KD_TREE_H
+#define HERA_WS_DNN_LOCAL_IMPLICIT_KD_TREE_H
+
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "bucket-kernels.h"
+
+namespace hera
+{
+namespace ws
+{
+namespace dnn
+{
+    // Weighted kd-tree laid out implicitly in Eytzinger (BFS) order: node k
+    // has children 2k + 1 and 2k + 2 and parent (k - 1) / 2, the tree being
+    // complete, so that no pointer or handle is stored. Its L leaves, L a
+    // power of two, are buckets of at most k_bucket_size points, leaf j
+    // holding the points of positions [j * n / L, (j + 1) * n / L); the
+    // inner nodes only keep the splitting coordinate along the axis of their
+    // depth. Coordinates are kept axis by axis (coordinates_[a * n + pos]),
+    // next to the weights, so that a bucket is scanned with the kernels of
+    // bucket-kernels.h. Points are identified by the integer id they were
+    // given, e.g. the index of an auction item. The value of a point for a
+    // query q is |q - p|_{internal_p}^{wasserstein_power} plus its weight.
+    // D is the dimension when it is known at compile time, and 0 otherwise;
+    // a fixed dimension unrolls the loops over the axes and ignores dim.
+    template<class Real_, size_t D = 0>
+    class ImplicitKDTree
+    {
+        public:
+            using Real = Real_;
+
+            struct Neighbour
+            {
+                size_t  id      { std::numeric_limits<size_t>::max() };
+                Real    value   { std::numeric_limits<Real>::max() };
+            };
+
+            static constexpr size_t k_bucket_size = 8;
+
+                            ImplicitKDTree(size_t dim, Real internal_p, Real wasserstein_power);
+
+            // coordinates holds the points one after another, ids their ids;
+            // all weights are set to zero
+            void            init(const std::vector<Real>& coordinates, const std::vector<size_t>& ids);
+
+            size_t          dimension() const                               { return D ? D : dim_; }
+            size_t          size() const                                    { return n_; }
+            bool            empty() const                                   { return n_ == 0; }
+
+            Real            weight(size_t id) const                         { return weights_[positions_[id]]; }
+            void            change_weight(size_t id, Real w);
+            // [first, last) holds (id, weight) pairs; the subtree minima of the
+            // changed leaves and their ancestors are recomputed once, bottom-up
+            template<class Iterator>
+            void            change_weights(Iterator first, Iterator last);
+            void            adjust_weights(Real delta);                     // subtract delta from all weights
+
+            // point of smallest value for q, an array of dim coordinates
+            Neighbour       find(const Real* q) const;
+            // two points of smallest values, the second one has an invalid
+            // id if the tree holds a single point
+            std::pair<Neighbour, Neighbour>
+                            find_two(const Real* q) const;
+
+        private:
+            template<size_t K>
+            void            search(const Real* q, Neighbour (&best)[K]) const;
+            template<size_t K>
+            void            scan_leaf(size_t k, const Real* q, Neighbour (&best)[K]) const;
+
+            Real            to_power(Real d) const;
+
+            bool            is_leaf(size_t k) const                         { return k + 1 >= num_leaves_; }
+            size_t          leaf_begin(size_t leaf) const                   { return leaf * n_ / num_leaves_; }
+            size_t          leaf_of(size_t pos) const                       { return ((pos + 1) * num_leaves_ - 1) / n_; }
+            size_t          leaf_node(size_t leaf) const                    { return leaf + num_leaves_ - 1; }
+            Real            subtree_min(size_t k) const;                    // from the children or the bucket
+
+            size_t              dim_;
+            Real                internal_p_;
+            Real                wasserstein_power_;
+            hera::dnn::Norm     norm_;
+            size_t              n_ { 0 };
+            size_t              num_leaves_ { 1 };
+            std::vector<Real>   coordinates_;
+            std::vector<Real>   weights_;               // point weight, by position
+            std::vector<size_t> ids_;                   // position -> id
+            std::vector<size_t> positions_;             // id -> position
+            std::vector<Real>   splits_;                // inner node -> splitting coordinate
+            std::vector<Real>   subtree_weights_;       // min weight in the subtree
+            std::vector<char>   dirty_;                 // node marks of change_weights
+            std::vector<std::vector<size_t>>    dirty_nodes_;   // marked nodes by depth
+    };
+} // dnn
+} // ws
+} // hera
+
+#include "implicit-kd-tree.hpp"
+
+#endif
@@ -0,0 +1,309 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "../../common/infinity.h"
+#include "../parallel/tbb.h" // for task_group
+
+template<class R, size_t D>
+hera::ws::dnn::ImplicitKDTree<R, D>::
+ImplicitKDTree(size_t dim, Real internal_p, Real wasserstein_power):
+    dim_(dim), internal_p_(internal_p), wasserstein_power_(wasserstein_power),
+    norm_(hera::dnn::norm_of(internal_p))
+{}
+
+template<class R, size_t D>
+void
+hera::ws::dnn::ImplicitKDTree<R, D>::
+init(const std::vector<Real>& coordinates, const std::vector<size_t>& ids)
+{
+    n_ = ids.size();
+    num_leaves_ = 1;
+    while (num_leaves_ * k_bucket_size < n_)
+        num_leaves_ *= 2;
+
+    coordinates_.assign(dimension() * n_, 0);
+    weights_.assign(n_, 0);
+    ids_.assign(n_, 0);
+    positions_.assign(n_ == 0 ? 0 : *std::max_element(ids.begin(), ids.end()) + 1, 0);
+    splits_.assign(num_leaves_ - 1, 0);
+    subtree_weights_.assign(2 * num_leaves_ - 1, 0);
+    dirty_.assign(2 * num_leaves_ - 1, 0);
+    if (n_ == 0)
+        return;
+
+    std::vector<size_t> points(n_);
+    for (size_t i = 0; i < n_; ++i)
+        points[i] = i;
+
+    // node k covers the leaves [jb, je) and the points of positions [b, e);
+    // an inner node splits them at the median leaf along the axis of its depth
+    struct Build
+    {
+        ImplicitKDTree*             tree;
+        std::vector<size_t>*        points;
+        const std::vector<Real>*    coordinates;
+        const std::vector<size_t>*  ids;
+        size_t                      jb, je, k, depth;
+
+        void operator()() const
+        {
+            const size_t dim = tree->dimension(), n = tree->n_;
+            const size_t b = tree->leaf_begin(jb), e = tree->leaf_begin(je);
+            const std::vector<Real>& c = *coordinates;
+
+            if (je - jb == 1)
+            {
+                for (size_t pos = b; pos < e; ++pos)
+                {
+                    const size_t i = (*points)[pos];
+                    for (size_t a = 0; a < dim; ++a)
+                        tree->coordinates_[a * n + pos] = c[i * dim + a];
+                    tree->ids_[pos] = (*ids)[i];
+                    tree->positions_[(*ids)[i]] = pos;
+                }
+                return;
+            }
+
+            const size_t axis = depth % dim;
+            const size_t jm = (jb + je) / 2, m = tree->leaf_begin(jm);
+            auto first = points->begin() + b, middle = points->begin() + m, last = points->begin() + e;
+            std::nth_element(first, middle, last,
+                             [&c, dim, axis](size_t i, size_t j) { return c[i * dim + axis] < c[j * dim + axis]; });
+            tree->splits_[k] = c[*middle * dim + axis];
+
+            Build left  { tree, points, coordinates, ids, jb, jm, 2 * k + 1, depth + 1 };
+            Build right { tree, points, coordinates, ids, jm, je, 2 * k + 2, depth + 1 };
+            if (e - b < 1000)
+            {
+                left();
+                right();
+                return;
+            }
+            hera::dnn::task_group g;
+            g.run(left);
+            g.run(right);
+            g.wait();
+        }
+    };
+
+    Build root { this, &points, &coordinates, &ids, 0, num_leaves_, 0, 0 };
+#if defined(TBB)
+    hera::dnn::task_group g;
+    g.run(root);
+    g.wait();
+#else
+    if (n_ >= (1 << 15))
+        hera::dnn::run_tasks(root);
+    else
+        root();
+#endif
+}
+
+template<class R, size_t D>
+typename hera::ws::dnn::ImplicitKDTree<R, D>::Real
+hera::ws::dnn::ImplicitKDTree<R, D>::
+to_power(Real d) const
+{
+    if (wasserstein_power_ == 1.0)
+        return d;
+    if (wasserstein_power_ == 2.0)
+        return d * d;
+    return std::pow(d, wasserstein_power_);
+}
+
+template<class R, size_t D>
+template<size_t K>
+void
+hera::ws::dnn::ImplicitKDTree<R, D>::
+scan_leaf(size_t k, const Real* q, Neighbour (&best)[K]) const
+{
+    const size_t leaf = k + 1 - num_leaves_;
+    const size_t b = leaf_begin(leaf), m = leaf_begin(leaf + 1) - b;
+    Real values[k_bucket_size];
+    hera::dnn::bucket_values<D>(coordinates_.data() + b, n_, dimension(), weights_.data() + b, m,
+                             q, norm_, internal_p_, wasserstein_power_, values);
+
+    for (size_t i = 0; i < m; ++i)
+    {
+        const Real value = values[i];
+        if (value < best[K - 1].value)
+        {
+            size_t j = K - 1;
+            for (; j > 0 && value < best[j - 1].value; --j)
+                best[j] = best[j - 1];
+            best[j] = Neighbour { ids_[b + i], value };
+        }
+    }
+}
+
+template<class R, size_t D>
+template<size_t K>
+void
+hera::ws::dnn::ImplicitKDTree<R, D>::
+search(const Real* q, Neighbour (&best)[K]) const
+{
+    // node, its depth and a lower bound on the distance from q to its subtree
+    struct Entry
+    {
+        size_t  k, depth;
+        Real    bound;
+    };
+    // one entry is pushed per level at most
+    Entry   stack[8 * sizeof(size_t)];
+    size_t  top = 0;
+
+    if (n_ > 0)
+        stack[top++] = Entry { 0, 0, 0 };
+
+    while (top > 0)
+    {
+        Entry entry = stack[--top];
+        size_t k = entry.k, depth = entry.depth;
+        const Real bound = entry.bound;
+        const Real bound_value = to_power(bound);
+
+        while (true)
+        {
+            if (bound_value + subtree_weights_[k] > best[K - 1].value)
+                break;
+            if (is_leaf(k))
+            {
+                scan_leaf(k, q, best);
+                break;
+            }
+
+            // the far side is at least |diff| away along the axis
+            const size_t axis = depth % dimension();
+            const Real diff = q[axis] - splits_[k];
+            const size_t near = diff < 0 ? 2 * k + 1 : 2 * k + 2;
+            const size_t far  = diff < 0 ? 2 * k + 2 : 2 * k + 1;
+            const Real far_bound = std::max(bound, std::fabs(diff));
+            if (to_power(far_bound) + subtree_weights_[far] <= best[K - 1].value)
+                stack[top++] = Entry { far, depth + 1, far_bound };
+            k = near;
+            ++depth;
+        }
+    }
+}
+
+template<class R, size_t D>
+typename hera::ws::dnn::ImplicitKDTree<R, D>::Neighbour
+hera::ws::dnn::ImplicitKDTree<R, D>::
+find(const Real* q) const
+{
+    Neighbour best[1];
+    search(q, best);
+    return best[0];
+}
+
+template<class R, size_t D>
+std::pair<typename hera::ws::dnn::ImplicitKDTree<R, D>::Neighbour, typename hera::ws::dnn::ImplicitKDTree<R, D>::Neighbour>
+hera::ws::dnn::ImplicitKDTree<R, D>::
+find_two(const Real* q) const
+{
+    Neighbour best[2];
+    search(q, best);
+    return std::make_pair(best[0], best[1]);
+}
+
+template<class R, size_t D>
+typename hera::ws::dnn::ImplicitKDTree<R, D>::Real
+hera::ws::dnn::ImplicitKDTree<R, D>::
+subtree_min(size_t k) const
+{
+    if (is_leaf(k))
+    {
+        const size_t leaf = k + 1 - num_leaves_;
+        const size_t e = leaf_begin(leaf + 1);
+        Real result = std::numeric_limits<Real>::max();
+        for (size_t pos = leaf_begin(leaf); pos < e; ++pos)
+            result = std::min(result, weights_[pos]);
+        return result;
+    }
+    return std::min(subtree_weights_[2 * k + 1], subtree_weights_[2 * k + 2]);
+}
+
+template<class R, size_t D>
+void
+hera::ws::dnn::ImplicitKDTree<R, D>::
+change_weight(size_t id, Real w)
+{
+    const size_t pos = positions_[id];
+    if (weights_[pos] == w)
+        return;
+
+    weights_[pos] = w;
+    size_t k = leaf_node(leaf_of(pos));
+
+    // recompute the subtree minima up to the first one that does not change
+    while (true)
+    {
+        Real min_w = subtree_min(k);
+        if (subtree_weights_[k] == min_w)
+            break;
+        subtree_weights_[k] = min_w;
+        if (k == 0)
+            break;
+        k = (k - 1) / 2;
+    }
+}
+
+template<class R, size_t D>
+template<class Iterator>
+void
+hera::ws::dnn::ImplicitKDTree<R, D>::
+change_weights(Iterator first, Iterator last)
+{
+    // the leaves are at depth log2(L); the marked nodes are recomputed
+    // level by level from the bottom, their parents marked only if their
+    // minimum changed
+    size_t leaf_depth = 0;
+    while ((size_t(1) << leaf_depth) < num_leaves_)
+        ++leaf_depth;
+    if (dirty_nodes_.size() <= leaf_depth)
+        dirty_nodes_.resize(leaf_depth + 1);
+
+    for (; first != last; ++first)
+    {
+        const size_t pos = positions_[first->first];
+        weights_[pos] = first->second;
+        const size_t k = leaf_node(leaf_of(pos));
+        if (!dirty_[k])
+        {
+            dirty_[k] = 1;
+            dirty_nodes_[leaf_depth].push_back(k);
+        }
+    }
+
+    for (size_t d = dirty_nodes_.size(); d-- > 0;)
+    {
+        for (size_t k : dirty_nodes_[d])
+        {
+            dirty_[k] = 0;
+            Real min_w = subtree_min(k);
+            if (subtree_weights_[k] == min_w)
+                continue;
+            subtree_weights_[k] = min_w;
+            size_t parent = (k - 1) / 2;
+            if (k > 0 && !dirty_[parent])
+            {
+                dirty_[parent] = 1;
+                dirty_nodes_[d - 1].push_back(parent);
+            }
+        }
+        dirty_nodes_[d].clear();
+    }
+}
+
+template<class R, size_t D>
+void
+hera::ws::dnn::ImplicitKDTree<R, D>::
+adjust_weights(Real delta)
+{
+    for (auto& w : weights_)
+        w -= delta;
+
+    for (auto& sw : subtree_weights_)
+        sw -= delta;
+}
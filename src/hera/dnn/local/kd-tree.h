@@ -3,6 +3,7 @@
 
 #include "../utils.h"
 #include "search-functors.h"
+#include "bucket-kernels.h"
 
 #include <unordered_map>
 #include <stack>
@@ -81,6 +82,9 @@ namespace dnn
             struct CoordinateComparison;
             struct OrderTree;
 
+            // trees at least this large are ordered by parallel tasks
+            static constexpr size_t k_parallel_build_size = 1 << 15;
+
         private:
             Traits              traits_;
             HandleContainer     tree_;
@@ -165,9 +169,16 @@ namespace dnn
             struct CoordinateComparison;
             struct OrderTree;
 
+            // trees at least this large are ordered by parallel tasks
+            static constexpr size_t k_parallel_build_size = 1 << 15;
+            // subtrees of at most this many points are scanned at once, with
+            // the kernels of bucket-kernels.h
+            static constexpr size_t k_bucket_size = 8;
+
         //private:
             Traits              traits_;
             HandleContainer     tree_;
+            std::vector<Coordinate> coordinates_;       // axis by axis, in the order of tree_
             std::vector<char>   delete_flags_;
             std::vector<int>    subtree_n_elems;
             HandleMap           indices_;
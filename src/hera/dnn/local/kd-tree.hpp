@@ -2,6 +2,7 @@
 #include <boost/range/algorithm_ext/push_back.hpp>
 #include <boost/range.hpp>
 
+#include <iostream>
 #include <queue>
 #include <stack>
 
@@ -51,9 +52,13 @@ init()
     g.run(OrderTree(tree_.begin(), tree_.end(), 0, traits()));
     g.wait();
 #else
-    OrderTree(tree_.begin(), tree_.end(), 0, traits()).serial();
+    if (tree_.size() >= k_parallel_build_size)
+        hera::dnn::run_tasks(OrderTree(tree_.begin(), tree_.end(), 0, traits()));
+    else
+        OrderTree(tree_.begin(), tree_.end(), 0, traits()).serial();
 #endif
 
+    indices_.reserve(tree_.size());
     for (size_t i = 0; i < tree_.size(); ++i)
         indices_[tree_[i]] = i;
 }
@@ -371,12 +376,22 @@ void hera::bt::dnn::KDTree<T>::init()
     g.run(OrderTree(this, tree_.begin(), tree_.end(), -1, 0, traits()));
     g.wait();
 #else
-    OrderTree(this, tree_.begin(), tree_.end(), -1, 0, traits()).serial();
+    if (tree_.size() >= k_parallel_build_size)
+        hera::dnn::run_tasks(OrderTree(this, tree_.begin(), tree_.end(), -1, 0, traits()));
+    else
+        OrderTree(this, tree_.begin(), tree_.end(), -1, 0, traits()).serial();
 #endif
 
+    indices_.reserve(tree_.size());
     for (size_t i = 0; i < tree_.size(); ++i)
         indices_[tree_[i]] = i;
     init_n_elems();
+
+    const size_t n = tree_.size();
+    coordinates_.resize(n * traits().dimension());
+    for (size_t a = 0; a < traits().dimension(); ++a)
+        for (size_t i = 0; i < n; ++i)
+            coordinates_[a * n + i] = traits().coordinate(tree_[i], a);
 }
 
 template<class T>
@@ -480,6 +495,9 @@ void hera::bt::dnn::KDTree<T>::init_n_elems()
 }
 
 
+// Subtrees of at most k_bucket_size points are scanned as buckets: the
+// distances of all their points are computed together, and the deleted ones
+// are skipped when they are reported.
 template<class T>
 template<class ResultsFunctor>
 void hera::bt::dnn::KDTree<T>::search(PointHandle q, ResultsFunctor& rf) const
@@ -492,6 +510,14 @@ void hera::bt::dnn::KDTree<T>::search(PointHandle q, ResultsFunctor& rf) const
 
     DistanceType    D  = std::numeric_limits<DistanceType>::infinity();
 
+    const size_t n = tree_.size();
+    const size_t dim = traits().dimension();
+    std::vector<Coordinate> q_coordinates(dim);
+    for (size_t a = 0; a < dim; ++a)
+        q_coordinates[a] = traits().coordinate(q, a);
+    const DistanceType zero_weights[k_bucket_size] {};
+    DistanceType values[k_bucket_size];
+
     // TODO: use tbb::scalable_allocator for the queue
     std::queue<KDTreeNode>  nodes;
 
@@ -505,6 +531,19 @@ void hera::bt::dnn::KDTree<T>::search(PointHandle q, ResultsFunctor& rf) const
         std::tie(b,e,i) = nodes.front();
         nodes.pop();
 
+        if (static_cast<size_t>(e - b) <= k_bucket_size)
+        {
+            // the bottleneck distance is that of l_inf, to the power 1
+            const size_t first = b - tree_.begin(), m = e - b;
+            hera::dnn::bucket_values(coordinates_.data() + first, n, dim, zero_weights, m,
+                                     q_coordinates.data(), hera::dnn::Norm::l_inf,
+                                     DistanceType(-1), DistanceType(1), values);
+            for (size_t k = 0; k < m; ++k)
+                if (delete_flags_[first + k] == 0)
+                    D = rf(tree_[first + k], values[k]);
+            continue;
+        }
+
         CoordinateComparison cmp(i, traits());
         i = (i + 1) % traits().dimension();
 
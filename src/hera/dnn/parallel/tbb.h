@@ -136,6 +136,10 @@ namespace boost
 #include <algorithm>
 #include <map>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 namespace hera
 {
 namespace dnn
@@ -196,13 +200,60 @@ namespace dnn
         static const unsigned deferred  = 0;
     };
 
+    // Without TBB, tasks are OpenMP tasks: they run in parallel inside
+    // run_tasks() and in the calling thread elsewhere.
     struct task_group
     {
         template<class Functor>
-        void    run(const Functor& f) const             { f(); }
-        void    wait() const                            {}
+        void    run(const Functor& f) const
+        {
+#ifdef _OPENMP
+            Functor g(f);
+            #pragma omp task firstprivate(g)
+            g();
+#else
+            f();
+#endif
+        }
+
+        void    wait() const
+        {
+#ifdef _OPENMP
+            #pragma omp taskwait
+#endif
+        }
     };
 
+    // Number of OpenMP threads run_tasks() may use, shared by all translation
+    // units. It is 1, i.e. no parallel build, until set_task_threads() raises it.
+    inline int&         task_threads_setting()
+    {
+        static int n = 1;
+        return n;
+    }
+
+    inline int          task_threads()                                                  { return task_threads_setting(); }
+    inline void         set_task_threads(int n)                                         { task_threads_setting() = std::max(n, 1); }
+
+    // Runs f on a team of task_threads() OpenMP threads, at most the thread
+    // limit, which pick up the tasks it spawns through task_group. Inside a
+    // parallel region, or with a single thread, f runs in the calling thread.
+    template<class Functor>
+    void                run_tasks(const Functor& f)
+    {
+#ifdef _OPENMP
+        const int num_threads = std::min(task_threads(), omp_get_thread_limit());
+        if (omp_get_level() == 0 && num_threads > 1)
+        {
+            #pragma omp parallel num_threads(num_threads)
+            #pragma omp single
+            f();
+            return;
+        }
+#endif
+        f();
+    }
+
     template<class ID, class NodePointer, class IDTraits, class Allocator>
     struct map_traits
     {
@@ -39,6 +39,7 @@ derivative works thereof, in binary and source code form.
 #include "wasserstein/auction_result.h"
 #include "common/diagram_reader.h"
 #include "wasserstein/auction_runner_gs.h"
+#include "wasserstein/auction_oracle_lazy_heap.h"
 #include "wasserstein/auction_runner_jac.h"
 
 
@@ -71,20 +72,18 @@ namespace ws
         return m1 == m2;
     }
 
-    // to handle points with one coordinate = infinity
+    // to handle points with one coordinate = infinity,
+    // pts_A and pts_B must be sorted
     template<class T, class P, class R>
-    inline void get_one_dimensional_cost(std::vector<T>& pts_A, std::vector<T>& pts_B, const P& params, R& result)
+    inline void get_one_dimensional_cost(const std::vector<T>& pts_A, const std::vector<T>& pts_B, const P& params, R& result)
     {
-        using RealType = typename std::remove_reference<decltype(std::get<0>(pts_A[0]))>::type;
+        using RealType = typename std::remove_const<typename std::remove_reference<decltype(std::get<0>(pts_A[0]))>::type>::type;
 
         if (pts_A.size() != pts_B.size()) {
             result.cost = std::numeric_limits<RealType>::infinity();
             return;
         }
 
-        std::sort(pts_A.begin(), pts_A.end());
-        std::sort(pts_B.begin(), pts_B.end());
-
         for(size_t i = 0; i < pts_A.size(); ++i) {
             RealType a = std::get<0>(pts_A[i]);
             RealType b = std::get<0>(pts_B[i]);
@@ -191,13 +190,76 @@ namespace ws
 
     };
 
+    // The lazy heap oracle keeps a dense cost matrix and one heap per bidder,
+    // the kd-tree oracle searches a kd-tree of the items. Timings of both on
+    // random diagrams (see sandbox/oracle-crossover.R) show that:
+    // - for q = 1 the kd-tree is faster at every size;
+    // - for q > 1 the lazy heap is up to 1.8x faster on small diagrams; it
+    //   stays ahead up to about 275 points per diagram when the points are
+    //   packed (extent of the diagrams at most 8 times the mean persistence)
+    //   and up to fewer points as they spread out, the crossover falling
+    //   roughly like (extent / mean persistence)^(-0.3), to about 60 points
+    //   at a ratio of 2000.
+    template<class RealType>
+    inline bool use_lazy_heap_oracle(const std::vector<DiagramPoint<RealType>>& A,
+            const std::vector<DiagramPoint<RealType>>& B,
+            const AuctionParams<RealType>& params)
+    {
+        constexpr RealType max_bidders = 550;
+        constexpr RealType packed_spread = 8;
+
+        if (params.oracle_type != AuctionOracleType::automatic)
+            return params.oracle_type == AuctionOracleType::lazy_heap;
+
+        if (params.wasserstein_power == 1 or A.size() > max_bidders)
+            return false;
+
+        // bidders are the normal points of A and the projections of B,
+        // items the projections of A and the normal points of B
+        RealType min_coord = std::numeric_limits<RealType>::max();
+        RealType max_coord = std::numeric_limits<RealType>::lowest();
+        RealType total_persistence = 0;
+        size_t num_points = 0;
+        auto add_point = [&](const DiagramPoint<RealType>& point) {
+            min_coord = std::min({min_coord, point.getRealX(), point.getRealY()});
+            max_coord = std::max({max_coord, point.getRealX(), point.getRealY()});
+            total_persistence += point.getRealY() - point.getRealX();
+            ++num_points;
+        };
+        for(const auto& point : A)
+            if (point.is_normal())
+                add_point(point);
+        for(const auto& point : B)
+            if (point.is_normal())
+                add_point(point);
+
+        if (num_points == 0 or total_persistence <= 0)
+            return false;
+
+        RealType spread = (max_coord - min_coord) / (total_persistence / num_points);
+        RealType crossover = max_bidders * std::min(RealType(1), std::pow(spread / packed_spread, RealType(-0.3)));
+        return A.size() <= crossover;
+    }
+
+    template<class RealType, class AuctionOracle>
+    inline AuctionResult<RealType> run_auction_gs(const std::vector<DiagramPoint<RealType>>& A,
+            const std::vector<DiagramPoint<RealType>>& B,
+            const AuctionParams<RealType>& params,
+            const std::vector<RealType>& prices)
+    {
+        AuctionRunnerGS<RealType, AuctionOracle> auction(A, B, params, prices);
+        auction.run_auction();
+        return std::move(auction.get_result());
+    }
+
     // CAUTION:
     // this function assumes that all coordinates are finite
     // points at infinity are processed in wasserstein_cost
     template<class RealType>
     inline AuctionResult<RealType> wasserstein_cost_vec_detailed(const std::vector<DiagramPoint<RealType>>& A,
             const std::vector<DiagramPoint<RealType>>& B,
-            const AuctionParams<RealType> params)
+            const AuctionParams<RealType> params,
+            const std::vector<RealType>& prices = std::vector<RealType>())
     {
         if (params.wasserstein_power < 1.0) {
             throw std::runtime_error("Bad q in Wasserstein " + std::to_string(params.wasserstein_power));
@@ -217,10 +279,10 @@ namespace ws
         }
 
         // just use Gauss-Seidel
-        AuctionRunnerGS<RealType> auction(A, B, params);
-
-        auction.run_auction();
-        return auction.get_result();
+        if (use_lazy_heap_oracle(A, B, params))
+            return run_auction_gs<RealType, AuctionOracleLazyHeapRestricted<RealType>>(A, B, params, prices);
+        else
+            return run_auction_gs<RealType, AuctionOracleKDTreeRestricted<RealType>>(A, B, params, prices);
     }
 
     // CAUTION:
@@ -269,130 +331,363 @@ namespace ws
 
 } // ws
 
-template<class PairContainer>
-inline AuctionResult<typename DiagramTraits<PairContainer>::RealType>
-wasserstein_cost_detailed(const PairContainer& A,
-        const PairContainer& B,
-        const AuctionParams<typename DiagramTraits<PairContainer>::RealType >& params)
+namespace ws
 {
-    using Traits = DiagramTraits<PairContainer>;
-    using RealType  = typename Traits::RealType;
-    using DgmPoint = hera::DiagramPoint<RealType>;
-    using OneDimPoint = std::tuple<RealType, int>;
 
-    constexpr RealType plus_inf = std::numeric_limits<RealType>::infinity();
-    constexpr RealType minus_inf = -std::numeric_limits<RealType>::infinity();
+    // A persistence diagram split into the parts the Wasserstein distance is
+    // computed from: finite off-diagonal points (in container order), points
+    // with one infinite coordinate (sorted by the finite one) and the numbers of
+    // points with both coordinates infinite. A diagram can be prepared once and
+    // compared with several others.
+    template<class RealType>
+    struct PreparedDiagram
+    {
+        using OneDimPoint = std::tuple<RealType, int>;
 
-    // TODO: return matching here too?
-    if (hera::ws::are_equal(A, B)) {
-        return AuctionResult<RealType>();
-    }
+        std::vector<DiagramPoint<RealType>> finite_points;
+        std::vector<OneDimPoint> x_plus, x_minus, y_plus, y_minus;
+        // points with both coordinates infinite are treated as equal
+        int n_minus_inf_plus_inf {0};
+        int n_plus_inf_minus_inf {0};
 
-    bool finite_a_empty = true;
-    bool finite_b_empty = true;
-    RealType total_cost_A = 0;
-    RealType total_cost_B = 0;
-
-    std::vector<DgmPoint> dgm_A, dgm_B;
-    // points at infinity
-    std::vector<OneDimPoint> x_plus_A, x_minus_A, y_plus_A, y_minus_A;
-    std::vector<OneDimPoint> x_plus_B, x_minus_B, y_plus_B, y_minus_B;
-    // points with both coordinates infinite are treated as equal
-    int n_minus_inf_plus_inf_A = 0;
-    int n_plus_inf_minus_inf_A = 0;
-    int n_minus_inf_plus_inf_B = 0;
-    int n_plus_inf_minus_inf_B = 0;
-    // loop over A, add projections of A-points to corresponding positions
-    // in B-vector
-    for(auto&& point_A : A) {
-        RealType x = Traits::get_x(point_A);
-        RealType y = Traits::get_y(point_A);
-        int  id = Traits::get_id(point_A);
-
-        // skip diagonal points, including (inf, inf), (-inf, -inf)
-        if (x == y) {
-            continue;
-        }
-
-        if (x == plus_inf && y == minus_inf) {
-            n_plus_inf_minus_inf_A++;
-        } else if (x == minus_inf && y == plus_inf) {
-            n_minus_inf_plus_inf_A++;
-        } else if ( x == plus_inf) {
-            y_plus_A.emplace_back(y, Traits::get_id(point_A));
-        } else if (x == minus_inf) {
-            y_minus_A.emplace_back(y, Traits::get_id(point_A));
-        } else if (y == plus_inf) {
-            x_plus_A.emplace_back(x, Traits::get_id(point_A));
-        } else if (y == minus_inf) {
-            x_minus_A.emplace_back(x, Traits::get_id(point_A));
-        } else {
-            dgm_A.emplace_back(x, y,  DgmPoint::NORMAL, id);
-            dgm_B.emplace_back(x, y,  DgmPoint::DIAG, -id - 1);
-            finite_a_empty = false;
-            total_cost_A += std::pow(dgm_A.back().persistence_lp(params.internal_p), params.wasserstein_power);
+        void clear()
+        {
+            finite_points.clear();
+            x_plus.clear();
+            x_minus.clear();
+            y_plus.clear();
+            y_minus.clear();
+            n_minus_inf_plus_inf = 0;
+            n_plus_inf_minus_inf = 0;
+        }
+
+        // diagonal points, including (inf, inf), (-inf, -inf), are skipped
+        void add_point(RealType x, RealType y, int id)
+        {
+            constexpr RealType plus_inf = std::numeric_limits<RealType>::infinity();
+            constexpr RealType minus_inf = -std::numeric_limits<RealType>::infinity();
+
+            if (x == y) {
+                return;
+            }
+
+            if (x == plus_inf && y == minus_inf) {
+                n_plus_inf_minus_inf++;
+            } else if (x == minus_inf && y == plus_inf) {
+                n_minus_inf_plus_inf++;
+            } else if ( x == plus_inf) {
+                y_plus.emplace_back(y, id);
+            } else if (x == minus_inf) {
+                y_minus.emplace_back(y, id);
+            } else if (y == plus_inf) {
+                x_plus.emplace_back(x, id);
+            } else if (y == minus_inf) {
+                x_minus.emplace_back(x, id);
+            } else {
+                finite_points.emplace_back(x, y, DiagramPoint<RealType>::NORMAL, id);
+            }
+        }
+
+        // to be called after the last add_point
+        void sort_essential()
+        {
+            std::sort(x_plus.begin(), x_plus.end());
+            std::sort(x_minus.begin(), x_minus.end());
+            std::sort(y_plus.begin(), y_plus.end());
+            std::sort(y_minus.begin(), y_minus.end());
         }
+    };
+
+    template<class PairContainer>
+    inline void prepare_diagram(const PairContainer& dgm,
+            PreparedDiagram<typename DiagramTraits<PairContainer>::RealType>& result)
+    {
+        using Traits = DiagramTraits<PairContainer>;
+
+        // ids are positions in the container, matchings are keyed by them
+        result.clear();
+        int pos = 0;
+        for(auto&& point : dgm) {
+            result.add_point(Traits::get_x(point), Traits::get_y(point), pos++);
+        }
+        result.sort_essential();
     }
-    // the same for B
-    for(auto&& point_B : B) {
-        RealType x = Traits::get_x(point_B);
-        RealType y = Traits::get_y(point_B);
-        int     id = Traits::get_id(point_B);
-
-        if (x == y) {
-            continue;
-        }
-
-        if (x == plus_inf && y == minus_inf) {
-            n_plus_inf_minus_inf_B++;
-        } else if (x == minus_inf && y == plus_inf) {
-            n_minus_inf_plus_inf_B++;
-        } else if (x == plus_inf) {
-            y_plus_B.emplace_back(y, Traits::get_id(point_B));
-        } else if (x == minus_inf) {
-            y_minus_B.emplace_back(y, Traits::get_id(point_B));
-        } else if (y == plus_inf) {
-            x_plus_B.emplace_back(x, Traits::get_id(point_B));
-        } else if (y == minus_inf) {
-            x_minus_B.emplace_back(x, Traits::get_id(point_B));
-        } else {
-            dgm_A.emplace_back(x, y,  DgmPoint::DIAG, -id - 1);
-            dgm_B.emplace_back(x, y,  DgmPoint::NORMAL, id);
-            finite_b_empty = false;
-            total_cost_B += std::pow(dgm_B.back().persistence_lp(params.internal_p), params.wasserstein_power);
+
+    // Prepare two diagrams at once. Off-diagonal points of both are sorted
+    // into flat arrays and walked in step, which tells whether the diagrams
+    // are equal and, if cancel_duplicates is set, finds the points that occur
+    // in both (they are then left out, which is exact for q = 1).
+    // Returns true, without preparing anything, if the diagrams are equal.
+    // If shared_points is not null, it receives the (position in A, position
+    // in B) pairs of the points that were left out, or of all off-diagonal
+    // points if the diagrams are equal.
+    template<class PairContainer>
+    inline bool prepare_diagrams(const PairContainer& dgm_A,
+            const PairContainer& dgm_B,
+            const bool cancel_duplicates,
+            PreparedDiagram<typename DiagramTraits<PairContainer>::RealType>& result_A,
+            PreparedDiagram<typename DiagramTraits<PairContainer>::RealType>& result_B,
+            std::vector<std::pair<int, int>>* shared_points = nullptr)
+    {
+        using Traits = DiagramTraits<PairContainer>;
+        using RealType  = typename Traits::RealType;
+        // x, y, position in the container
+        using SortKey = std::tuple<RealType, RealType, size_t>;
+
+        std::vector<SortKey> keys_A, keys_B;
+        size_t size_A = 0, size_B = 0;
+        for(auto&& point : dgm_A) {
+            RealType x = Traits::get_x(point);
+            RealType y = Traits::get_y(point);
+            if (x != y)
+                keys_A.emplace_back(x, y, size_A);
+            ++size_A;
         }
+        for(auto&& point : dgm_B) {
+            RealType x = Traits::get_x(point);
+            RealType y = Traits::get_y(point);
+            if (x != y)
+                keys_B.emplace_back(x, y, size_B);
+            ++size_B;
+        }
+        std::sort(keys_A.begin(), keys_A.end());
+        std::sort(keys_B.begin(), keys_B.end());
+
+        std::vector<bool> cancelled_A, cancelled_B;
+        if (cancel_duplicates) {
+            cancelled_A.assign(size_A, false);
+            cancelled_B.assign(size_B, false);
+        }
+
+        bool are_equal = keys_A.size() == keys_B.size();
+        size_t i = 0, j = 0;
+        while(i < keys_A.size() && j < keys_B.size()) {
+            auto point_A = std::make_pair(std::get<0>(keys_A[i]), std::get<1>(keys_A[i]));
+            auto point_B = std::make_pair(std::get<0>(keys_B[j]), std::get<1>(keys_B[j]));
+            if (point_A < point_B) {
+                are_equal = false;
+                ++i;
+            } else if (point_B < point_A) {
+                are_equal = false;
+                ++j;
+            } else {
+                if (cancel_duplicates) {
+                    cancelled_A[std::get<2>(keys_A[i])] = true;
+                    cancelled_B[std::get<2>(keys_B[j])] = true;
+                }
+                if (shared_points)
+                    shared_points->emplace_back(std::get<2>(keys_A[i]), std::get<2>(keys_B[j]));
+                ++i;
+                ++j;
+            }
+        }
+
+        if (are_equal)
+            return true;
+
+        if (shared_points and not cancel_duplicates)
+            shared_points->clear();
+
+        result_A.clear();
+        size_t pos = 0;
+        for(auto&& point : dgm_A) {
+            if (not cancel_duplicates or not cancelled_A[pos])
+                result_A.add_point(Traits::get_x(point), Traits::get_y(point), pos);
+            ++pos;
+        }
+        result_A.sort_essential();
+
+        result_B.clear();
+        pos = 0;
+        for(auto&& point : dgm_B) {
+            if (not cancel_duplicates or not cancelled_B[pos])
+                result_B.add_point(Traits::get_x(point), Traits::get_y(point), pos);
+            ++pos;
+        }
+        result_B.sort_essential();
+
+        return false;
     }
 
-    AuctionResult<RealType> infinity_result;
-
-    if (n_plus_inf_minus_inf_A != n_plus_inf_minus_inf_B || n_minus_inf_plus_inf_A != n_minus_inf_plus_inf_B) {
-        infinity_result.cost = plus_inf;
-        infinity_result.distance = plus_inf;
-        return infinity_result;
-    } else {
-        ws::get_one_dimensional_cost(x_plus_A, x_plus_B, params, infinity_result);
-        ws::get_one_dimensional_cost(x_minus_A, x_minus_B, params, infinity_result);
-        ws::get_one_dimensional_cost(y_plus_A, y_plus_B, params, infinity_result);
-        ws::get_one_dimensional_cost(y_minus_A, y_minus_B, params, infinity_result);
+    // Mark the points with the smallest costs to the diagonal (q-th powers of
+    // persistence) as pruned, as long as the error bound stays within
+    // params.prune_error_budget, and add their cost to pruned_cost.
+    // If P_A, P_B are the pruned costs and C is the cost of the reduced
+    // diagrams, then W(A, B) <= (C + P_A + P_B)^(1/q) by matching the pruned
+    // points to the diagonal, and W(A, B) >= C^(1/q) - P_A^(1/q) - P_B^(1/q)
+    // by the triangle inequality, so (C + P_A + P_B)^(1/q) is off by at most
+    // (P_A + P_B)^(1/q) + P_A^(1/q) + P_B^(1/q), which is returned.
+    template<class RealType>
+    inline RealType prune_low_persistence(const std::vector<RealType>& diagonal_costs_A,
+            const std::vector<RealType>& diagonal_costs_B,
+            const AuctionParams<RealType>& params,
+            std::vector<bool>& pruned_A,
+            std::vector<bool>& pruned_B,
+            RealType& pruned_cost,
+            int& num_pruned_points)
+    {
+        const RealType q = params.wasserstein_power;
+        auto error_bound = [q](RealType cost_A, RealType cost_B) {
+            return std::pow(cost_A + cost_B, 1 / q) + std::pow(cost_A, 1 / q) + std::pow(cost_B, 1 / q);
+        };
+
+        // (cost, index), indices of B shifted by the size of A
+        std::vector<std::pair<RealType, size_t>> candidates;
+        candidates.reserve(diagonal_costs_A.size() + diagonal_costs_B.size());
+        for(size_t i = 0; i < diagonal_costs_A.size(); ++i)
+            candidates.emplace_back(diagonal_costs_A[i], i);
+        for(size_t i = 0; i < diagonal_costs_B.size(); ++i)
+            candidates.emplace_back(diagonal_costs_B[i], diagonal_costs_A.size() + i);
+        std::sort(candidates.begin(), candidates.end());
+
+        RealType cost_A = 0, cost_B = 0, bound = 0;
+        for(const auto& candidate : candidates) {
+            bool is_A = candidate.second < diagonal_costs_A.size();
+            RealType new_cost_A = cost_A + (is_A ? candidate.first : 0);
+            RealType new_cost_B = cost_B + (is_A ? 0 : candidate.first);
+            RealType new_bound = error_bound(new_cost_A, new_cost_B);
+            if (new_bound > params.prune_error_budget)
+                break;
+            if (is_A)
+                pruned_A[candidate.second] = true;
+            else
+                pruned_B[candidate.second - diagonal_costs_A.size()] = true;
+            cost_A = new_cost_A;
+            cost_B = new_cost_B;
+            bound = new_bound;
+            ++num_pruned_points;
+        }
+
+        pruned_cost += cost_A + cost_B;
+        return bound;
     }
 
-    if (finite_a_empty) {
-        AuctionResult<RealType> b_res;
-        b_res.cost = total_cost_B;
-        return add_results(b_res, infinity_result, params.wasserstein_power);
+    // prices: see hera::wasserstein_cost_detailed
+    template<class RealType>
+    inline AuctionResult<RealType> wasserstein_cost_prepared(const PreparedDiagram<RealType>& A,
+            const PreparedDiagram<RealType>& B,
+            const AuctionParams<RealType>& params,
+            const std::vector<RealType>& prices = std::vector<RealType>())
+    {
+        using DgmPoint = hera::DiagramPoint<RealType>;
+
+        constexpr RealType plus_inf = std::numeric_limits<RealType>::infinity();
+
+        AuctionResult<RealType> infinity_result;
+
+        if (A.n_plus_inf_minus_inf != B.n_plus_inf_minus_inf || A.n_minus_inf_plus_inf != B.n_minus_inf_plus_inf) {
+            infinity_result.cost = plus_inf;
+            infinity_result.distance = plus_inf;
+            return infinity_result;
+        } else {
+            get_one_dimensional_cost(A.x_plus, B.x_plus, params, infinity_result);
+            get_one_dimensional_cost(A.x_minus, B.x_minus, params, infinity_result);
+            get_one_dimensional_cost(A.y_plus, B.y_plus, params, infinity_result);
+            get_one_dimensional_cost(A.y_minus, B.y_minus, params, infinity_result);
+        }
+
+        std::vector<RealType> diagonal_costs_A, diagonal_costs_B;
+        diagonal_costs_A.reserve(A.finite_points.size());
+        diagonal_costs_B.reserve(B.finite_points.size());
+        for(const auto& point_A : A.finite_points)
+            diagonal_costs_A.push_back(std::pow(point_A.persistence_lp(params.internal_p), params.wasserstein_power));
+        for(const auto& point_B : B.finite_points)
+            diagonal_costs_B.push_back(std::pow(point_B.persistence_lp(params.internal_p), params.wasserstein_power));
+
+        // prices refer to the unpruned layout, so pruning is only done for
+        // cold-started auctions
+        std::vector<bool> pruned_A(A.finite_points.size(), false), pruned_B(B.finite_points.size(), false);
+        if (params.prune_error_budget > 0 && prices.empty()) {
+            infinity_result.prune_error_bound = prune_low_persistence(diagonal_costs_A, diagonal_costs_B,
+                    params, pruned_A, pruned_B, infinity_result.cost, infinity_result.num_pruned_points);
+        }
+
+        RealType total_cost_A = 0;
+        RealType total_cost_B = 0;
+        size_t num_finite_A = 0;
+        size_t num_finite_B = 0;
+
+        std::vector<DgmPoint> dgm_A, dgm_B;
+        dgm_A.reserve(A.finite_points.size() + B.finite_points.size());
+        dgm_B.reserve(A.finite_points.size() + B.finite_points.size());
+        // loop over A, add projections of A-points to corresponding positions
+        // in B-vector
+        for(size_t i = 0; i < A.finite_points.size(); ++i) {
+            if (pruned_A[i])
+                continue;
+            const auto& point_A = A.finite_points[i];
+            dgm_A.push_back(point_A);
+            dgm_B.emplace_back(point_A.x, point_A.y, DgmPoint::DIAG, -point_A.id - 1);
+            total_cost_A += diagonal_costs_A[i];
+            ++num_finite_A;
+        }
+        // the same for B
+        for(size_t i = 0; i < B.finite_points.size(); ++i) {
+            if (pruned_B[i])
+                continue;
+            const auto& point_B = B.finite_points[i];
+            dgm_A.emplace_back(point_B.x, point_B.y, DgmPoint::DIAG, -point_B.id - 1);
+            dgm_B.push_back(point_B);
+            total_cost_B += diagonal_costs_B[i];
+            ++num_finite_B;
+        }
+
+        if (num_finite_A == 0) {
+            AuctionResult<RealType> b_res;
+            b_res.cost = total_cost_B;
+            return add_results(std::move(b_res), std::move(infinity_result), params.wasserstein_power);
+        }
+
+        if (num_finite_B == 0) {
+            AuctionResult<RealType> a_res;
+            a_res.cost = total_cost_A;
+            return add_results(std::move(a_res), std::move(infinity_result), params.wasserstein_power);
+        }
+
+        if (infinity_result.cost == plus_inf) {
+            infinity_result.distance = plus_inf;
+            return infinity_result;
+        } else {
+            return add_results(std::move(infinity_result), wasserstein_cost_vec_detailed(dgm_A, dgm_B, params, prices), params.wasserstein_power);
+        }
     }
 
-    if (finite_b_empty) {
-        AuctionResult<RealType> a_res;
-        a_res.cost = total_cost_A;
-        return add_results(a_res, infinity_result, params.wasserstein_power);
+} // ws
+
+// prices, if not empty, are the initial prices of the auction items (warm start).
+// Items are the projections of the finite off-diagonal points of A,
+// followed by the finite off-diagonal points of B, both in container order;
+// the prices of the result follow the same layout.
+template<class PairContainer>
+inline AuctionResult<typename DiagramTraits<PairContainer>::RealType>
+wasserstein_cost_detailed(const PairContainer& A,
+        const PairContainer& B,
+        const AuctionParams<typename DiagramTraits<PairContainer>::RealType >& params,
+        const std::vector<typename DiagramTraits<PairContainer>::RealType>& prices = std::vector<typename DiagramTraits<PairContainer>::RealType>())
+{
+    using RealType = typename DiagramTraits<PairContainer>::RealType;
+
+    // prices refer to the full layout, so duplicates are kept for warm starts
+    bool cancel_duplicates = params.remove_duplicates && prices.empty();
+
+    ws::PreparedDiagram<RealType> prepared_A, prepared_B;
+    std::vector<std::pair<int, int>> shared_points;
+    auto shared_points_ptr = params.return_matching ? &shared_points : nullptr;
+
+    AuctionResult<RealType> result;
+    if (not ws::prepare_diagrams(A, B, cancel_duplicates, prepared_A, prepared_B, shared_points_ptr)) {
+        result = ws::wasserstein_cost_prepared(prepared_A, prepared_B, params, prices);
     }
 
-    if (infinity_result.cost == plus_inf) {
-        return infinity_result;
-    } else {
-        return add_results(infinity_result, hera::ws::wasserstein_cost_vec_detailed(dgm_A, dgm_B, params), params.wasserstein_power);
+    if (params.return_matching) {
+        // matching is keyed by positions in A and B, points left out
+        // of the auction are matched to the diagonal
+        result.resize_matching(std::distance(A.begin(), A.end()), std::distance(B.begin(), B.end()));
+        for(const auto& edge : shared_points)
+            result.add_to_matching(edge.first, edge.second);
     }
+
+    return result;
 }
 
 
@@ -30,36 +30,39 @@ derivative works thereof, in binary and source code form.
 #define AUCTION_ORACLE_KDTREE_PURE_GEOM_H
 
 
-#include <map>
-#include <memory>
-#include <set>
-
-#include <boost/range/adaptor/transformed.hpp>
-
-namespace ba = boost::adaptors;
+#include <limits>
+#include <vector>
 
 #include "basic_defs_ws.h"
 #include "auction_oracle_base.h"
+#include "diagonal_heap.h"
 #include <hera/dnn/geometry/euclidean-dynamic.h>
-#include <hera/dnn/local/kd-tree.h>
+#include <hera/dnn/local/implicit-kd-tree.h>
 
 namespace hera
 {
 namespace ws
 {
 
-template <class Real_ = double, class PointContainer_ = hera::ws::dnn::DynamicPointVector<Real_>>
+// Id of the virtual points of a partial matching (AuctionParams::deletion_cost):
+// the bidders are a point cloud followed by one virtual point per point of the
+// other cloud, and so are the items. Matching a point to a virtual point
+// deletes it at cost deletion_cost^wasserstein_power, virtual points match
+// each other at no cost, as points of a diagram and the diagonal do.
+constexpr size_t k_virtual_point_id = std::numeric_limits<size_t>::max();
+
+// D is the dimension of the points when it is known at compile time, 0 otherwise
+template <class Real_ = double, class PointContainer_ = hera::ws::dnn::DynamicPointVector<Real_>, size_t D = 0>
 struct AuctionOracleKDTreePureGeom : AuctionOracleBase<Real_, PointContainer_> {
 
     using Real = Real_;
     using DynamicPointTraitsR = typename hera::ws::dnn::DynamicPointTraits<Real>;
     using DiagramPointR = typename DynamicPointTraitsR::PointType;
-    using PointHandleR = typename DynamicPointTraitsR::PointHandle;
     using PointContainer = PointContainer_;
     using DebugOptimalBidR  = typename ws::DebugOptimalBid<Real>;
 
     using DynamicPointTraits = hera::ws::dnn::DynamicPointTraits<Real>;
-    using KDTreeR = hera::ws::dnn::KDTree<DynamicPointTraits>;
+    using KDTreeR = hera::ws::dnn::ImplicitKDTree<Real, D>;
 
     AuctionOracleKDTreePureGeom(const PointContainer& bidders, const PointContainer& items, const AuctionParams<Real>& params);
     ~AuctionOracleKDTreePureGeom();
@@ -69,14 +72,28 @@ struct AuctionOracleKDTreePureGeom : AuctionOracleBase<Real_, PointContainer_> {
     DynamicPointTraits traits;
     Real max_val_;
     Real weight_adj_const_;
-    std::unique_ptr<KDTreeR> kdtree_;
-    std::vector<size_t> kdtree_items_;
+    KDTreeR kdtree_;
+    std::vector<Real> query_;       // coordinates of the bidder, gathered for the kd-tree
+    // partial matching only
+    bool partial_;
+    Real deletion_cost_;            // deletion_cost^wasserstein_power
+    std::vector<char> is_virtual_bidder_;
+    std::vector<char> is_virtual_item_;
+    LossesHeapOld<Real> real_items_heap_;      // items by price, for virtual bidders
+    LossesHeapOld<Real> virtual_items_heap_;
+    std::vector<typename LossesHeapOld<Real>::handle_type> heap_handles_;
     // methods
     void set_price(const IdxType items_idx, const Real new_price);
     void set_prices(const std::vector<Real>& new_prices);
+    void set_prices(const std::vector<IdxValPair<Real>>& new_prices);
     IdxValPair<Real> get_optimal_bid(const IdxType bidder_idx);
+    Real get_best_item_value(const IdxType bidder_idx);
     void adjust_prices();
     void adjust_prices(const Real delta);
+    const Real* bidder_coordinates(const IdxType bidder_idx);
+    Real get_cost(const IdxType bidder_idx, const IdxType item_idx) const;
+    std::pair<IdxValPair<Real>, IdxValPair<Real>> get_two_best_items(const IdxType bidder_idx);
+    void update_heap(const IdxType item_idx, const bool item_goes_down);
 
     // debug routines
     DebugOptimalBidR get_optimal_bid_debug(IdxType bidder_idx) const;
@@ -50,8 +50,8 @@ namespace ws {
 
 
 
-template <class Real_, class PointContainer_>
-std::ostream& operator<<(std::ostream& output, const AuctionOracleKDTreePureGeom<Real_, PointContainer_>& oracle)
+template <class Real_, class PointContainer_, size_t D>
+std::ostream& operator<<(std::ostream& output, const AuctionOracleKDTreePureGeom<Real_, PointContainer_, D>& oracle)
 {
     output << "Oracle " << &oracle << std::endl;
     output << "max_val_ = " <<  oracle.max_val_ << "\n";
@@ -61,48 +61,91 @@ std::ostream& operator<<(std::ostream& output, const AuctionOracleKDTreePureGeom
 }
 
 
-template<class Real_, class PointContainer_>
-AuctionOracleKDTreePureGeom<Real_, PointContainer_>::AuctionOracleKDTreePureGeom(const PointContainer_& _bidders,
+template<class Real_, class PointContainer_, size_t D>
+AuctionOracleKDTreePureGeom<Real_, PointContainer_, D>::AuctionOracleKDTreePureGeom(const PointContainer_& _bidders,
                                                                                  const PointContainer_& _items,
                                                                                  const AuctionParams<Real_>& params) :
     AuctionOracleBase<Real_, PointContainer_>(_bidders, _items, params),
-    traits(params.dim)
+    traits(params.dim, params.internal_p),
+    kdtree_(params.dim, params.internal_p, params.wasserstein_power),
+    query_(params.dim),
+    partial_(false),
+    deletion_cost_(params.deletion_cost >= 0 ? std::pow(params.deletion_cost, params.wasserstein_power) : 0),
+    is_virtual_bidder_(this->num_bidders_, 0),
+    is_virtual_item_(this->num_items_, 0)
 {
-
-    traits.internal_p = params.internal_p;
-
-    std::vector<PointHandleR> item_handles(this->num_items_);
-    for(size_t i = 0; i < this->num_items_; ++i) {
-        item_handles[i] = traits.handle(this->items[i]);
+    std::vector<size_t> real_bidders, real_items;
+    for(size_t bidder_idx = 0; bidder_idx < this->num_bidders_; ++bidder_idx) {
+        is_virtual_bidder_[bidder_idx] = this->bidders.id(bidder_idx) == k_virtual_point_id;
+        if (!is_virtual_bidder_[bidder_idx])
+            real_bidders.push_back(bidder_idx);
     }
+    for(size_t item_idx = 0; item_idx < this->num_items_; ++item_idx) {
+        is_virtual_item_[item_idx] = this->items.id(item_idx) == k_virtual_point_id;
+        if (!is_virtual_item_[item_idx])
+            real_items.push_back(item_idx);
+    }
+    partial_ = real_bidders.size() < this->num_bidders_ or real_items.size() < this->num_items_;
+
+    // store real items in kd-tree, keyed by item index
+    std::vector<Real> coordinates;
+    coordinates.reserve(kdtree_.dimension() * real_items.size());
+    for(size_t item_idx : real_items) {
+        for(size_t a = 0; a < kdtree_.dimension(); ++a)
+            coordinates.push_back(this->items.coordinate(item_idx, a));
+    }
+    kdtree_.init(coordinates, real_items);
 
-    //kdtree_ = std::unique_ptr<KDTreeR>(new KDTreeR(traits,
-    //        this->items | ba::transformed([this](const DiagramPointR& p) { return traits.handle(p); }),
-    //        params.wasserstein_power));
-
-    kdtree_ = std::unique_ptr<KDTreeR>(new KDTreeR(traits, item_handles, params.wasserstein_power));
-
+    if (partial_) {
+        heap_handles_.reserve(this->num_items_);
+        for(size_t item_idx = 0; item_idx < this->num_items_; ++item_idx) {
+            auto& heap = is_virtual_item_[item_idx] ? virtual_items_heap_ : real_items_heap_;
+            heap_handles_.push_back(heap.push(std::make_pair(static_cast<IdxType>(item_idx), Real(0))));
+        }
+    }
 
-    max_val_ = 3*getFurthestDistance3Approx_pg(this->bidders, this->items, params.internal_p, params.dim);
-    max_val_ = std::pow(max_val_, params.wasserstein_power);
+    // as getFurthestDistance3Approx_pg, on the real points
+    Real furthest = 0;
+    if (!real_bidders.empty() and !real_items.empty()) {
+        size_t opt_item_idx = real_items[0];
+        for(size_t item_idx : real_items) {
+            Real d = dist_lp<Real>(this->bidders[real_bidders[0]], this->items[item_idx], params.internal_p, params.dim);
+            if (d > furthest) {
+                furthest = d;
+                opt_item_idx = item_idx;
+            }
+        }
+        for(size_t bidder_idx : real_bidders)
+            furthest = std::max(furthest, dist_lp<Real>(this->bidders[bidder_idx], this->items[opt_item_idx], params.internal_p, params.dim));
+    }
+    max_val_ = std::pow(3 * furthest, params.wasserstein_power);
+    if (partial_)
+        max_val_ = std::max(max_val_, deletion_cost_);
     weight_adj_const_ = max_val_;
 }
 
-
-template<class Real_, class PointContainer_>
-typename AuctionOracleKDTreePureGeom<Real_, PointContainer_>::DebugOptimalBidR
-AuctionOracleKDTreePureGeom<Real_, PointContainer_>::get_optimal_bid_debug(IdxType bidder_idx) const
+template<class Real_, class PointContainer_, size_t D>
+Real_ AuctionOracleKDTreePureGeom<Real_, PointContainer_, D>::get_cost(IdxType bidder_idx, IdxType item_idx) const
 {
-    auto bidder = this->bidders[bidder_idx];
+    if (is_virtual_bidder_[bidder_idx])
+        return is_virtual_item_[item_idx] ? Real(0) : deletion_cost_;
+    if (is_virtual_item_[item_idx])
+        return deletion_cost_;
+    return std::pow(dist_lp<Real>(this->bidders[bidder_idx], this->items[item_idx], this->internal_p, this->dim), this->wasserstein_power);
+}
+
 
+template<class Real_, class PointContainer_, size_t D>
+typename AuctionOracleKDTreePureGeom<Real_, PointContainer_, D>::DebugOptimalBidR
+AuctionOracleKDTreePureGeom<Real_, PointContainer_, D>::get_optimal_bid_debug(IdxType bidder_idx) const
+{
     size_t best_item_idx = k_invalid_index;
     size_t second_best_item_idx = k_invalid_index;
     Real best_item_value = std::numeric_limits<Real>::max();
     Real second_best_item_value = std::numeric_limits<Real>::max();
 
     for(size_t item_idx = 0; item_idx < this->items.size(); ++item_idx) {
-        auto item = this->items[item_idx];
-        auto item_value = std::pow(traits.distance(bidder, item), this->wasserstein_power) + this->prices[item_idx];
+        auto item_value = get_cost(bidder_idx, item_idx) + this->prices[item_idx];
         if (item_value < best_item_value) {
             best_item_value = item_value;
             best_item_idx = item_idx;
@@ -112,11 +155,10 @@ AuctionOracleKDTreePureGeom<Real_, PointContainer_>::get_optimal_bid_debug(IdxTy
     assert(best_item_idx != k_invalid_index);
 
     for(size_t item_idx = 0; item_idx < this->items.size(); ++item_idx) {
-        auto item = this->items[item_idx];
         if (item_idx == best_item_idx)
             continue;
 
-        auto item_value = std::pow(traits.distance(bidder, item), this->wasserstein_power) + this->prices[item_idx];
+        auto item_value = get_cost(bidder_idx, item_idx) + this->prices[item_idx];
         if (item_value < second_best_item_value) {
             second_best_item_value = item_value;
             second_best_item_idx = item_idx;
@@ -137,13 +179,54 @@ AuctionOracleKDTreePureGeom<Real_, PointContainer_>::get_optimal_bid_debug(IdxTy
 }
 
 
-template<class Real_, class PointContainer_>
-IdxValPair<Real_> AuctionOracleKDTreePureGeom<Real_, PointContainer_>::get_optimal_bid(IdxType bidder_idx)
+template<class Real_, class PointContainer_, size_t D>
+std::pair<IdxValPair<Real_>, IdxValPair<Real_>>
+AuctionOracleKDTreePureGeom<Real_, PointContainer_, D>::get_two_best_items(IdxType bidder_idx)
 {
-    auto two_best_items = kdtree_->findK(this->bidders[bidder_idx], 2);
-    size_t best_item_idx = traits.id(two_best_items[0].p);
-    Real best_item_value = two_best_items[0].d;
-    Real second_best_item_value = two_best_items[1].d;
+    IdxValPair<Real> best { k_invalid_index, std::numeric_limits<Real>::max() };
+    IdxValPair<Real> second_best { k_invalid_index, std::numeric_limits<Real>::max() };
+    auto add_candidate = [&best, &second_best](size_t item_idx, Real value) {
+        if (value < best.second) {
+            second_best = best;
+            best = std::make_pair(static_cast<IdxType>(item_idx), value);
+        } else if (value < second_best.second) {
+            second_best = std::make_pair(static_cast<IdxType>(item_idx), value);
+        }
+    };
+    // the two cheapest items of a heap, at cost plus their price
+    auto add_heap_top = [&add_candidate](const LossesHeapOld<Real>& heap, Real cost) {
+        auto iter = heap.ordered_begin();
+        for(int k = 0; k < 2 and iter != heap.ordered_end(); ++k, ++iter)
+            add_candidate(iter->first, cost + iter->second);
+    };
+
+    if (is_virtual_bidder_[bidder_idx]) {
+        add_heap_top(real_items_heap_, deletion_cost_);
+        add_heap_top(virtual_items_heap_, Real(0));
+    } else {
+        if (!kdtree_.empty()) {
+            auto two_best_items = kdtree_.find_two(bidder_coordinates(bidder_idx));
+            add_candidate(two_best_items.first.id, two_best_items.first.value);
+            if (kdtree_.size() > 1)
+                add_candidate(two_best_items.second.id, two_best_items.second.value);
+        }
+        add_heap_top(virtual_items_heap_, deletion_cost_);
+    }
+
+    // a single item has no competitor, its bid only adds epsilon
+    if (second_best.first == static_cast<IdxType>(k_invalid_index))
+        second_best.second = best.second;
+
+    return std::make_pair(best, second_best);
+}
+
+template<class Real_, class PointContainer_, size_t D>
+IdxValPair<Real_> AuctionOracleKDTreePureGeom<Real_, PointContainer_, D>::get_optimal_bid(IdxType bidder_idx)
+{
+    auto two_best_items = get_two_best_items(bidder_idx);
+    size_t best_item_idx = two_best_items.first.first;
+    Real best_item_value = two_best_items.first.second;
+    Real second_best_item_value = two_best_items.second.second;
 
     IdxValPair<Real> result;
 
@@ -161,25 +244,57 @@ IdxValPair<Real_> AuctionOracleKDTreePureGeom<Real_, PointContainer_>::get_optim
     return result;
 }
 
+template<class Real_, class PointContainer_, size_t D>
+Real_ AuctionOracleKDTreePureGeom<Real_, PointContainer_, D>::get_best_item_value(IdxType bidder_idx)
+{
+    if (!partial_)
+        return kdtree_.find(bidder_coordinates(bidder_idx)).value;
+    return get_two_best_items(bidder_idx).first.second;
+}
+
+template<class Real_, class PointContainer_, size_t D>
+const Real_* AuctionOracleKDTreePureGeom<Real_, PointContainer_, D>::bidder_coordinates(IdxType bidder_idx)
+{
+    const size_t dim = D ? D : query_.size();
+    for(size_t a = 0; a < dim; ++a)
+        query_[a] = this->bidders.coordinate(bidder_idx, a);
+    return query_.data();
+}
+
 /*
 a_{ij} = d_{ij}
 value_{ij} = a_{ij} + price_j
 */
 
-template<class Real_, class PointContainer_>
-void AuctionOracleKDTreePureGeom<Real_, PointContainer_>::set_price(IdxType item_idx,
+template<class Real_, class PointContainer_, size_t D>
+void AuctionOracleKDTreePureGeom<Real_, PointContainer_, D>::set_price(IdxType item_idx,
                                                     Real new_price)
 {
     assert(this->prices.size() == this->items.size());
 	// adjust_prices decreases prices,
     // also this variable must be true in reverse phases of FR-auction
 
+    bool item_goes_down = new_price > this->prices[item_idx];
     this->prices[item_idx] = new_price;
-    kdtree_->change_weight( traits.handle(this->items[item_idx]), new_price);
+    if (!is_virtual_item_[item_idx])
+        kdtree_.change_weight(item_idx, new_price);
+    if (partial_)
+        update_heap(item_idx, item_goes_down);
 }
 
-template<class Real_, class PointContainer_>
-void AuctionOracleKDTreePureGeom<Real_, PointContainer_>::set_prices(const std::vector<Real_>& new_prices)
+template<class Real_, class PointContainer_, size_t D>
+void AuctionOracleKDTreePureGeom<Real_, PointContainer_, D>::update_heap(IdxType item_idx, bool item_goes_down)
+{
+    auto& heap = is_virtual_item_[item_idx] ? virtual_items_heap_ : real_items_heap_;
+    auto new_val = std::make_pair(item_idx, this->prices[item_idx]);
+    if (item_goes_down)
+        heap.decrease(heap_handles_[item_idx], new_val);
+    else
+        heap.increase(heap_handles_[item_idx], new_val);
+}
+
+template<class Real_, class PointContainer_, size_t D>
+void AuctionOracleKDTreePureGeom<Real_, PointContainer_, D>::set_prices(const std::vector<Real_>& new_prices)
 {
     if (new_prices.size() != this->items.size())
         throw std::runtime_error("new_prices size mismatch");
@@ -188,8 +303,22 @@ void AuctionOracleKDTreePureGeom<Real_, PointContainer_>::set_prices(const std::
         set_price(item_idx, new_prices[item_idx]);
 }
 
-template<class Real_, class PointContainer_>
-void AuctionOracleKDTreePureGeom<Real_, PointContainer_>::adjust_prices(Real delta)
+template<class Real_, class PointContainer_, size_t D>
+void AuctionOracleKDTreePureGeom<Real_, PointContainer_, D>::set_prices(const std::vector<IdxValPair<Real_>>& new_prices)
+{
+    if (partial_) {
+        for(const auto& item_price : new_prices)
+            set_price(item_price.first, item_price.second);
+        return;
+    }
+
+    for(const auto& item_price : new_prices)
+        this->prices[item_price.first] = item_price.second;
+    kdtree_.change_weights(new_prices.begin(), new_prices.end());
+}
+
+template<class Real_, class PointContainer_, size_t D>
+void AuctionOracleKDTreePureGeom<Real_, PointContainer_, D>::adjust_prices(Real delta)
 {
     if (delta == 0.0)
         return;
@@ -198,11 +327,16 @@ void AuctionOracleKDTreePureGeom<Real_, PointContainer_>::adjust_prices(Real del
         p -= delta;
     }
 
-    kdtree_->adjust_weights(delta);
+    kdtree_.adjust_weights(delta);
+
+    if (partial_) {
+        for(size_t item_idx = 0; item_idx < this->num_items_; ++item_idx)
+            update_heap(item_idx, delta < 0);
+    }
 }
 
-template<class Real_, class PointContainer_>
-void AuctionOracleKDTreePureGeom<Real_, PointContainer_>::adjust_prices()
+template<class Real_, class PointContainer_, size_t D>
+void AuctionOracleKDTreePureGeom<Real_, PointContainer_, D>::adjust_prices()
 {
     auto pr_begin = this->prices.begin();
     auto pr_end = this->prices.end();
@@ -210,20 +344,20 @@ void AuctionOracleKDTreePureGeom<Real_, PointContainer_>::adjust_prices()
     adjust_prices(min_price);
 }
 
-template<class Real_, class PointContainer_>
-std::pair<Real_, Real_> AuctionOracleKDTreePureGeom<Real_, PointContainer_>::get_minmax_price() const
+template<class Real_, class PointContainer_, size_t D>
+std::pair<Real_, Real_> AuctionOracleKDTreePureGeom<Real_, PointContainer_, D>::get_minmax_price() const
 {
     auto r = std::minmax_element(this->prices.begin(), this->prices.end());
     return std::make_pair(*r.first, *r.second);
 }
 
-template<class Real_, class PointContainer_>
-AuctionOracleKDTreePureGeom<Real_, PointContainer_>::~AuctionOracleKDTreePureGeom()
+template<class Real_, class PointContainer_, size_t D>
+AuctionOracleKDTreePureGeom<Real_, PointContainer_, D>::~AuctionOracleKDTreePureGeom()
 {
 }
 
-template<class Real_, class PointContainer_>
-void AuctionOracleKDTreePureGeom<Real_, PointContainer_>::sanity_check()
+template<class Real_, class PointContainer_, size_t D>
+void AuctionOracleKDTreePureGeom<Real_, PointContainer_, D>::sanity_check()
 {
 }
 
@@ -40,8 +40,7 @@ derivative works thereof, in binary and source code form.
 #include "basic_defs_ws.h"
 #include "diagonal_heap.h"
 #include "auction_oracle_base.h"
-#include "../dnn/geometry/euclidean-fixed.h"
-#include "../dnn/local/kd-tree.h"
+#include "../dnn/local/implicit-kd-tree.h"
 
 namespace hera {
 namespace ws {
@@ -57,8 +56,7 @@ struct AuctionOracleKDTreeRestricted : AuctionOracleBase<Real_, PointContainer_>
     using DiagramPointR     = typename hera::DiagramPoint<Real>;
     using DebugOptimalBidR  = typename ws::DebugOptimalBid<Real>;
 
-    using DnnPoint          = dnn::Point<2, Real>;
-    using DnnTraits         = dnn::PointTraits<DnnPoint>;
+    using KDTreeR           = dnn::ImplicitKDTree<Real, 2>;
 
     AuctionOracleKDTreeRestricted(const PointContainer& bidders, const PointContainer& items, const AuctionParams<Real>& params);
     ~AuctionOracleKDTreeRestricted();
@@ -66,13 +64,11 @@ struct AuctionOracleKDTreeRestricted : AuctionOracleBase<Real_, PointContainer_>
     // temporarily make everything public
     Real max_val_;
     Real weight_adj_const_;
-    dnn::KDTree<DnnTraits>* kdtree_;
-    std::vector<DnnPoint> dnn_points_;
-    std::vector<DnnPoint*> dnn_point_handles_;
+    KDTreeR* kdtree_;
+    std::vector<IdxValPair<Real>> kdtree_updates_;
     LossesHeapR diag_items_heap_;
     std::vector<LossesHeapRHandle> diag_heap_handles_;
     std::vector<size_t> heap_handles_indices_;
-    std::vector<size_t> kdtree_items_;
     std::vector<size_t> top_diag_indices_;
     std::vector<size_t> top_diag_lookup_;
     size_t top_diag_counter_ { 0 };
@@ -85,7 +81,10 @@ struct AuctionOracleKDTreeRestricted : AuctionOracleBase<Real_, PointContainer_>
     // methods
     void set_price(const IdxType items_idx, const Real new_price, const bool update_diag = true);
     void set_prices(const std::vector<Real>& new_prices);
+    // (item, price) pairs, the kd-tree is updated once
+    void set_prices(const std::vector<IdxValPair<Real>>& new_prices);
     IdxValPair<Real> get_optimal_bid(const IdxType bidder_idx);
+    Real get_best_item_value(const IdxType bidder_idx);
     void adjust_prices();
     void adjust_prices(const Real delta);
 
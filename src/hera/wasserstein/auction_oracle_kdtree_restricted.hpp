@@ -75,35 +75,25 @@ AuctionOracleKDTreeRestricted<Real_, PointContainer_>::AuctionOracleKDTreeRestri
                                                                    const AuctionParams<Real>& params) :
     AuctionOracleBase<Real>(_bidders, _items, params),
     heap_handles_indices_(_items.size(), k_invalid_index),
-    kdtree_items_(_items.size(), k_invalid_index),
     top_diag_lookup_(_items.size(), k_invalid_index)
 {
-    size_t dnn_item_idx { 0 };
-    size_t true_idx { 0 };
-    dnn_points_.clear();
-    dnn_points_.reserve(this->items.size());
-    // store normal items in kd-tree
-    for(const auto& g : this->items) {
-        if (g.is_normal() ) {
-            kdtree_items_[true_idx] = dnn_item_idx;
-            // index of items is id of dnn-point
-            DnnPoint p(true_idx);
-            p[0] = g.getRealX();
-            p[1] = g.getRealY();
-            dnn_points_.push_back(p);
-            assert(dnn_item_idx == dnn_points_.size() - 1);
-            dnn_item_idx++;
+    // store normal items in kd-tree, keyed by item index
+    std::vector<Real> coordinates;
+    std::vector<size_t> ids;
+    coordinates.reserve(2 * this->items.size());
+    ids.reserve(this->items.size());
+    for(size_t item_idx = 0; item_idx < this->items.size(); ++item_idx) {
+        const auto& g = this->items[item_idx];
+        if (g.is_normal()) {
+            coordinates.push_back(g.getRealX());
+            coordinates.push_back(g.getRealY());
+            ids.push_back(item_idx);
         }
-        true_idx++;
     }
 
-    assert(dnn_points_.size() < _items.size() );
-    for(size_t i = 0; i < dnn_points_.size(); ++i) {
-        dnn_point_handles_.push_back(&dnn_points_[i]);
-    }
-    DnnTraits traits;
-    traits.internal_p = params.internal_p;
-    kdtree_ = new dnn::KDTree<DnnTraits>(traits, dnn_point_handles_, params.wasserstein_power);
+    assert(ids.size() < _items.size());
+    kdtree_ = new KDTreeR(2, params.internal_p, params.wasserstein_power);
+    kdtree_->init(coordinates, ids);
 
     size_t handle_idx {0};
     for(size_t item_idx = 0; item_idx < _items.size(); ++item_idx) {
@@ -308,16 +298,14 @@ IdxValPair<Real_> AuctionOracleKDTreeRestricted<Real_, PointContainer_>::get_opt
     } else {
         // for normal bidder get 2 best items among non-diagonal points from
         // kdtree_
-        DnnPoint bidder_dnn;
-        bidder_dnn[0] = bidder.getRealX();
-        bidder_dnn[1] = bidder.getRealY();
-        auto two_best_items = kdtree_->findK(bidder_dnn, 2);
-        size_t best_normal_item_idx { two_best_items[0].p->id() };
-        Real best_normal_item_value { two_best_items[0].d };
+        const Real bidder_coords[2] { bidder.getRealX(), bidder.getRealY() };
+        auto two_best_items = kdtree_->find_two(bidder_coords);
+        size_t best_normal_item_idx { two_best_items.first.id };
+        Real best_normal_item_value { two_best_items.first.value };
         // if there is only one off-diagonal point in the second diagram,
-        // kd-tree will not return the second candidate.
-        // Set its value to inf, so it will always lose to the value of the projection
-        Real second_best_normal_item_value { two_best_items.size() == 1 ? std::numeric_limits<Real>::max() : two_best_items[1].d };
+        // kd-tree will not return the second candidate: its value is max,
+        // so it will always lose to the value of the projection
+        Real second_best_normal_item_value { two_best_items.second.value };
 
         if ( proj_item_value < best_normal_item_value) {
             best_item_idx = proj_item_idx;
@@ -350,6 +338,27 @@ IdxValPair<Real_> AuctionOracleKDTreeRestricted<Real_, PointContainer_>::get_opt
 
     return result;
 }
+// smallest value (cost + price) over all items the bidder can get,
+// same candidates as in get_optimal_bid
+template<class Real_, class PointContainer_>
+Real_ AuctionOracleKDTreeRestricted<Real_, PointContainer_>::get_best_item_value(IdxType bidder_idx)
+{
+    auto bidder = this->bidders[bidder_idx];
+    Real proj_item_value = this->get_value_for_bidder(bidder_idx, bidder_idx);
+
+    if (bidder.is_diagonal()) {
+        if (not best_diagonal_items_computed_) {
+            recompute_top_diag_items();
+        }
+        return std::min(proj_item_value, best_diagonal_item_value_);
+    } else {
+        const Real bidder_coords[2] { bidder.getRealX(), bidder.getRealY() };
+        if (kdtree_->empty())
+            return proj_item_value;
+        return std::min(proj_item_value, kdtree_->find(bidder_coords).value);
+    }
+}
+
 /*
 a_{ij} = d_{ij}
 value_{ij} = a_{ij} + price_j
@@ -387,9 +396,7 @@ void AuctionOracleKDTreeRestricted<Real_, PointContainer_>::set_price(IdxType it
 
     this->prices[item_idx] = new_price;
     if ( this->items[item_idx].is_normal() ) {
-        assert(0 <= item_idx and item_idx < static_cast<IdxType>(kdtree_items_.size()));
-        assert(kdtree_items_[item_idx] < dnn_point_handles_.size());
-        kdtree_->change_weight( dnn_point_handles_[kdtree_items_[item_idx]], new_price);
+        kdtree_->change_weight(item_idx, new_price);
     } else {
         assert(diag_heap_handles_.size() > heap_handles_indices_.at(item_idx));
 		if (item_goes_down) {
@@ -419,8 +426,26 @@ void AuctionOracleKDTreeRestricted<Real_, PointContainer_>::set_prices(const std
     if (new_prices.size() != this->items.size())
         throw std::runtime_error("new_prices size mismatch");
 
+    std::vector<IdxValPair<Real>> item_prices;
+    item_prices.reserve(this->num_items_);
     for(IdxType item_idx = 0; item_idx < static_cast<IdxType>(this->num_items_); ++item_idx)
-        set_price(item_idx, new_prices[item_idx]);
+        item_prices.emplace_back(item_idx, new_prices[item_idx]);
+    set_prices(item_prices);
+}
+
+template<class Real_, class PointContainer_>
+void AuctionOracleKDTreeRestricted<Real_, PointContainer_>::set_prices(const std::vector<IdxValPair<Real_>>& new_prices)
+{
+    kdtree_updates_.clear();
+    for(const auto& item_price : new_prices) {
+        if (this->items[item_price.first].is_normal()) {
+            this->prices[item_price.first] = item_price.second;
+            kdtree_updates_.push_back(item_price);
+        } else {
+            set_price(item_price.first, item_price.second);
+        }
+    }
+    kdtree_->change_weights(kdtree_updates_.begin(), kdtree_updates_.end());
 }
 
 
@@ -29,167 +29,96 @@ derivative works thereof, in binary and source code form.
 #ifndef AUCTION_ORACLE_LAZY_HEAP_H
 #define AUCTION_ORACLE_LAZY_HEAP_H
 
-
-#define USE_BOOST_HEAP
-
-#include <map>
-#include <memory>
-#include <set>
 #include <list>
+#include <vector>
 
-#ifdef USE_BOOST_HEAP
 #include <boost/heap/d_ary_heap.hpp>
-#endif
 
 #include "basic_defs_ws.h"
+#include "diagonal_heap.h"
 #include "auction_oracle_base.h"
 
 namespace hera {
 namespace ws {
 
-template <typename T>
-struct CompPairsBySecondStruct {
-    bool operator()(const IdxValPair<T>& a, const IdxValPair<T>& b) const
-    {
-        return a.second < b.second;
-    }
-};
-
-
-template <typename T>
-struct CompPairsBySecondGreaterStruct {
-    bool operator()(const IdxValPair<T>& a, const IdxValPair<T>& b) const
-    {
-        return a.second > b.second;
-    }
-};
-
-template <typename T>
-struct CompPairsBySecondLexStruct {
-    bool operator()(const IdxValPair<T>& a, const IdxValPair<T>& b) const
-    {
-        return a.second < b.second or (a.second == b.second and a.first > b.first);
-    }
-};
-
-template <typename T>
-struct CompPairsBySecondLexGreaterStruct {
-    bool operator()(const IdxValPair<T>& a, const IdxValPair<T>& b) const
-    {
-        return a.second > b.second or (a.second == b.second and a.first > b.first);
-    }
-};
+// min-heap of (item index, value) pairs with mutable values
+template <class Real>
+using LazyLossesHeap = boost::heap::d_ary_heap<IdxValPair<Real>, boost::heap::arity<2>, boost::heap::mutable_<true>, boost::heap::compare<CompPairsBySecondGreaterStruct<Real>>>;
 
-using ItemsTimePair = std::pair<IdxType, int>;
+// (position of normal item, moment of its last price change)
+using ItemsTimePair = std::pair<size_t, long int>;
 using UpdateList = std::list<ItemsTimePair>;
 using UpdateListIter = UpdateList::iterator;
 
+// Oracle for the restricted problem that keeps, for every normal bidder, all
+// normal items in a heap ordered by cost + price. The costs are stored in a
+// dense matrix, so memory is quadratic in the number of points: it is meant
+// for small diagrams, where it avoids the kd-tree traversal.
+// Heaps are updated lazily: items whose price changed are kept in
+// update_list_, most recent first, and a bidder's heap is only brought up to
+// date when the bidder is about to bid.
+// Heap values are stored without the shifts of adjust_prices, which are
+// accumulated in price_shift_ and subtracted when values are read.
+template <class Real_ = double, class PointContainer_ = std::vector<DiagramPoint<Real_>>>
+struct AuctionOracleLazyHeapRestricted : AuctionOracleBase<Real_, PointContainer_> {
 
-#ifdef USE_BOOST_HEAP
-template <class Real>
-using LossesHeap = boost::heap::d_ary_heap<IdxValPair<Real>, boost::heap::arity<2>, boost::heap::mutable_<true>, boost::heap::compare<CompPairsBySecondGreaterStruct<Real>>>;
-#else
-template<typename T, class ComparisonStruct>
-class IdxValHeap {
-public:
-    using InternalKeeper = std::set<IdxValPair<T>, ComparisonStruct>;
-    using handle_type = typename InternalKeeper::iterator;
-    // methods
-    handle_type push(const IdxValPair<T>& val)
-    {
-        auto res_pair = _heap.insert(val);
-        assert(res_pair.second);
-        assert(res_pair.first != _heap.end());
-        return res_pair.first;
-    }
-
-    void decrease(handle_type& handle, const IdxValPair<T>& new_val)
-    {
-        _heap.erase(handle);
-        handle = push(new_val);
-    }
-
-    void increase(handle_type& handle, const IdxValPair<T>& new_val)
-    {
-        _heap.erase(handle);
-        handle = push(new_val);
-
-    size_t size() const
-    {
-        return _heap.size();
-    }
-
-    handle_type ordered_begin()
-    {
-        return _heap.begin();
-    }
-
-    handle_type ordered_end()
-    {
-        return _heap.end();
-    }
-
-
-private:
-    std::set<IdxValPair<T>, ComparisonStruct> _heap;
-};
+    using PointContainer    = PointContainer_;
+    using Real              = Real_;
 
-// if we store losses, the minimal value should come first
-template <class Real>
-using LossesHeap = IdxValHeap<Real, CompPairsBySecondLexStruct>;
-#endif
+    using LossesHeapR       = LazyLossesHeap<Real>;
+    using LossesHeapRHandle = typename LossesHeapR::handle_type;
+    using DiagramPointR     = typename hera::DiagramPoint<Real>;
 
+    AuctionOracleLazyHeapRestricted(const PointContainer& bidders, const PointContainer& items, const AuctionParams<Real>& params);
 
-template <class Real = double>
-struct AuctionOracleLazyHeapRestricted : AuctionOracleBase<Real> {
-
-    using LossesHeapR = typename ws::LossesHeap<Real>;
-    using LossesHeapRHandle = typename ws::LossesHeap<Real>::handle_type;
-    using DiagramPointR = typename ws::DiagramPoint<Real>;
-
-
-     AuctionOracleLazyHeapRestricted(const std::vector<DiagramPointR>& bidders, const std::vector<DiagramPointR>& items, const Real wasserstein_power, const Real _internal_p = get_infinity<Real>());
-    ~AuctionOracleLazyHeapRestricted();
     // data members
     // temporarily make everything public
-    std::vector<std::vector<Real>> weight_matrix;
-    //Real weight_adj_const;
-    Real max_val;
-    // vector of heaps to find the best items
-    std::vector<LossesHeapR*> losses_heap;
-    std::vector<std::vector<size_t>> items_indices_for_heap_handles;
-    std::vector<std::vector<LossesHeapRHandle>> losses_heap_handles;
+    Real max_val_;
+    Real price_shift_ { 0 };
+
+    // normal items, and position of each item among them (k_invalid_index for diagonal items)
+    std::vector<IdxType> normal_items_;
+    std::vector<size_t> normal_item_positions_;
+    // row of each normal bidder in weights_ and losses_heaps_ (k_invalid_index for diagonal bidders)
+    std::vector<size_t> bidder_rows_;
+    // weights_[row * normal_items_.size() + pos] is the cost of the normal bidder to the normal item
+    std::vector<Real> weights_;
+    std::vector<LossesHeapR> losses_heaps_;
+    std::vector<std::vector<LossesHeapRHandle>> losses_heap_handles_;
+
+    // lazy update of losses_heaps_
+    UpdateList update_list_;
+    std::vector<UpdateListIter> items_iterators_;
+    std::vector<long int> bidders_update_moments_;
+    long int update_counter_ { 0 };
+
+    // diagonal items, value is the price
+    LossesHeapR diag_items_heap_;
+    std::vector<LossesHeapRHandle> diag_heap_handles_;
+    std::vector<size_t> heap_handles_indices_;
+    bool best_diagonal_items_computed_ { false };
+    IdxType best_diagonal_item_idx_ { static_cast<IdxType>(k_invalid_index) };
+    Real best_diagonal_item_value_;
+    Real second_best_diagonal_item_value_;
+
     // methods
-    void fill_in_losses_heap();
-    void set_price(const IdxType items_idx, const Real new_price);
+    void set_price(const IdxType items_idx, const Real new_price, const bool update_diag = true);
     void set_prices(const std::vector<Real>& new_prices);
+    void set_prices(const std::vector<IdxValPair<Real>>& new_prices);
     IdxValPair<Real> get_optimal_bid(const IdxType bidder_idx);
-    Real get_matching_weight(const std::vector<IdxType>& bidders_to_items) const;
+    Real get_best_item_value(const IdxType bidder_idx);
     void adjust_prices();
-    // to update the queue in lazy fashion
-    std::vector<UpdateListIter> items_iterators;
-    UpdateList update_list;
-    std::vector<int> bidders_update_moments;
-    int update_counter;
-    void update_queue_for_bidder(const IdxType bidder_idx);
-    LossesHeapR diag_items_heap;
-    std::vector<LossesHeapRHandle> diag_heap_handles;
-    std::vector<size_t> heap_handles_indices;
-    // debug
-
-    DebugOptimalBid<Real> get_optimal_bid_debug(const IdxType bidder_idx);
-
-    // for diagonal points
-    bool best_diagonal_items_computed;
-    size_t best_diagonal_item_idx;
-    Real best_diagonal_item_value;
-    size_t second_best_diagonal_item_idx;
-    Real second_best_diagonal_item_value;
+    void adjust_prices(const Real delta);
+
+    void update_queue_for_bidder(const size_t bidder_row);
+    void recompute_best_diagonal_items();
+    // two smallest values among the normal items of a normal bidder
+    std::pair<IdxValPair<Real>, Real> get_two_best_normal_items(const IdxType bidder_idx);
 };
 
-} // end of namespace ws
-} // end of namespace hera
+} // ws
+} // hera
 
-#include "auction_oracle_lazy_heap.h"
+#include "auction_oracle_lazy_heap.hpp"
 
 #endif
@@ -25,165 +25,215 @@ derivative works thereof, in binary and source code form.
 
   */
 
+#ifndef AUCTION_ORACLE_LAZY_HEAP_HPP
+#define AUCTION_ORACLE_LAZY_HEAP_HPP
+
 #include <assert.h>
 #include <algorithm>
-#include <functional>
-#include <iterator>
+#include <limits>
 
 #include "def_debug_ws.h"
-#include "auction_oracle.h"
+#include "auction_oracle_lazy_heap.h"
 
 
 #ifdef FOR_R_TDA
 #undef DEBUG_AUCTION
 #endif
 
+namespace hera {
 namespace ws {
 
 // *****************************
 // AuctionOracleLazyHeapRestricted
 // *****************************
 
-
-template<class Real>
-AuctionOracleLazyHeapRestricted<Real>::AuctionOracleLazyHeapRestricted(const std::vector<DiagramPoint<Real>>& _bidders,
-                                                                       const std::vector<DiagramPoint<Real>>& _items,
-                                                                       Real _wasserstein_power,
-                                                                       Real _internal_p) :
-    AuctionOracleAbstract<Real>(_bidders, _items, _wasserstein_power, _internal_p),
-    max_val(0.0),
-    bidders_update_moments(_bidders.size(), 0),
-    update_counter(0),
-    heap_handles_indices(_items.size(), k_invalid_index),
-    best_diagonal_items_computed(false)
+template<class Real_, class PointContainer_>
+AuctionOracleLazyHeapRestricted<Real_, PointContainer_>::AuctionOracleLazyHeapRestricted(const PointContainer_& _bidders,
+                                                                                         const PointContainer_& _items,
+                                                                                         const AuctionParams<Real>& params) :
+    AuctionOracleBase<Real, PointContainer_>(_bidders, _items, params),
+    normal_item_positions_(_items.size(), k_invalid_index),
+    bidder_rows_(_bidders.size(), k_invalid_index),
+    heap_handles_indices_(_items.size(), k_invalid_index)
 {
-    weight_matrix.reserve(_bidders.size());
-    //const Real max_dist_upper_bound = 3 * getFurthestDistance3Approx(b, g);
-    //weight_adj_const = pow(max_dist_upper_bound, wasserstein_power);
-    // init weight matrix
-    for(const auto& point_A : _bidders) {
-        std::vector<Real> weight_vec;
-        weight_vec.clear();
-        weight_vec.reserve(_bidders.size());
-        for(const auto& point_B : _items) {
-            Real val = pow(dist_lp(point_A, point_B, _internal_p), _wasserstein_power);
-            weight_vec.push_back( val );
-            if ( val > max_val )
-                max_val = val;
+    for(size_t item_idx = 0; item_idx < this->items.size(); ++item_idx) {
+        if (this->items[item_idx].is_normal()) {
+            normal_item_positions_[item_idx] = normal_items_.size();
+            normal_items_.push_back(static_cast<IdxType>(item_idx));
+        } else {
+            heap_handles_indices_[item_idx] = diag_heap_handles_.size();
+            diag_heap_handles_.push_back(diag_items_heap_.push(std::make_pair(static_cast<IdxType>(item_idx), Real(0.0))));
         }
-        weight_matrix.push_back(weight_vec);
-    }
-    fill_in_losses_heap();
-    for(size_t item_idx = 0; item_idx < _items.size(); ++item_idx) {
-        update_list.push_back(std::make_pair(static_cast<IdxType>(item_idx), 0));
     }
-    for(auto update_list_iter = update_list.begin(); update_list_iter != update_list.end(); ++update_list_iter) {
-        items_iterators.push_back(update_list_iter);
+
+    size_t num_normal_items = normal_items_.size();
+    size_t num_rows = 0;
+    for(size_t bidder_idx = 0; bidder_idx < this->bidders.size(); ++bidder_idx) {
+        if (this->bidders[bidder_idx].is_normal())
+            bidder_rows_[bidder_idx] = num_rows++;
     }
 
-    size_t handle_idx {0};
-    for(size_t item_idx = 0; item_idx < _items.size(); ++item_idx) {
-        if (_items[item_idx].is_diagonal() ) {
-            heap_handles_indices[item_idx] = handle_idx++;
-            diag_heap_handles.push_back(diag_items_heap.push(std::make_pair(item_idx, 0)));
+    weights_.reserve(num_rows * num_normal_items);
+    losses_heaps_.resize(num_rows);
+    losses_heap_handles_.resize(num_rows);
+    bidders_update_moments_.assign(num_rows, 0);
+    for(size_t bidder_idx = 0; bidder_idx < this->bidders.size(); ++bidder_idx) {
+        size_t row = bidder_rows_[bidder_idx];
+        if (row == k_invalid_index)
+            continue;
+        losses_heap_handles_[row].reserve(num_normal_items);
+        for(IdxType item_idx : normal_items_) {
+            Real weight = std::pow(dist_lp<Real>(this->bidders[bidder_idx], this->items[item_idx], this->internal_p, this->dim), this->wasserstein_power);
+            weights_.push_back(weight);
+            losses_heap_handles_[row].push_back(losses_heaps_[row].push(std::make_pair(item_idx, weight)));
         }
     }
+
+    for(size_t pos = 0; pos < num_normal_items; ++pos) {
+        items_iterators_.push_back(update_list_.insert(update_list_.end(), std::make_pair(pos, -1L)));
+    }
+
+    max_val_ = 3*getFurthestDistance3Approx<>(_bidders, _items, params.internal_p);
+    max_val_ = std::pow(max_val_, params.wasserstein_power);
 }
 
 
-template<class Real>
-void AuctionOracleLazyHeapRestricted<Real>::update_queue_for_bidder(IdxType bidder_idx)
+template<class Real_, class PointContainer_>
+void AuctionOracleLazyHeapRestricted<Real_, PointContainer_>::update_queue_for_bidder(const size_t bidder_row)
 {
-    assert(0 <= bidder_idx and bidder_idx < static_cast<int>(this->bidders.size()));
-    assert(bidder_idx < static_cast<int>(bidders_update_moments.size()));
-    assert(losses_heap[bidder_idx] != nullptr );
-
-    int bidder_last_update_time = bidders_update_moments[bidder_idx];
-    auto iter = update_list.begin();
-    while (iter != update_list.end() and iter->second >= bidder_last_update_time) {
-        IdxType item_idx = iter->first;
-        size_t handle_idx = items_indices_for_heap_handles[bidder_idx][item_idx];
-        if (handle_idx  < this->items.size() ) {
-            IdxValPair<Real> new_val { item_idx, weight_matrix[bidder_idx][item_idx] + this->prices[item_idx]};
-            // to-do: change indexing of losses_heap_handles
-            losses_heap[bidder_idx]->decrease(losses_heap_handles[bidder_idx][handle_idx], new_val);
-        }
-        iter++;
+    assert(bidder_row < losses_heaps_.size());
+
+    const size_t num_normal_items = normal_items_.size();
+    long int last_update_moment = bidders_update_moments_[bidder_row];
+    for(auto iter = update_list_.begin(); iter != update_list_.end() and iter->second >= last_update_moment; ++iter) {
+        size_t pos = iter->first;
+        IdxType item_idx = normal_items_[pos];
+        Real value = weights_[bidder_row * num_normal_items + pos] + this->prices[item_idx] + price_shift_;
+        losses_heaps_[bidder_row].update(losses_heap_handles_[bidder_row][pos], std::make_pair(item_idx, value));
     }
-    bidders_update_moments[bidder_idx] = update_counter;
+    bidders_update_moments_[bidder_row] = update_counter_;
 }
 
 
-template<class Real>
-void AuctionOracleLazyHeapRestricted<Real>::fill_in_losses_heap()
+template<class Real_, class PointContainer_>
+std::pair<IdxValPair<Real_>, Real_>
+AuctionOracleLazyHeapRestricted<Real_, PointContainer_>::get_two_best_normal_items(const IdxType bidder_idx)
 {
-    using LossesHeapR           = typename ws::LossesHeap<Real>;
-    using LossesHeapRHandleVec  = typename std::vector<typename ws::LossesHeap<Real>::handle_type>;
+    size_t row = bidder_rows_[bidder_idx];
+    assert(row != k_invalid_index);
+    update_queue_for_bidder(row);
+
+    const auto& heap = losses_heaps_[row];
+    if (heap.empty())
+        return std::make_pair(std::make_pair(static_cast<IdxType>(k_invalid_index), std::numeric_limits<Real>::max()), std::numeric_limits<Real>::max());
+
+    auto iter = heap.ordered_begin();
+    IdxValPair<Real> best { iter->first, iter->second - price_shift_ };
+    ++iter;
+    // if there is only one normal item, the second candidate
+    // always loses to the projection
+    Real second_best_value = iter == heap.ordered_end() ? std::numeric_limits<Real>::max() : iter->second - price_shift_;
+    return std::make_pair(best, second_best_value);
+}
 
-    for(size_t bidder_idx = 0; bidder_idx < this->bidders.size(); ++bidder_idx) {
-        DiagramPoint<Real> bidder { this->bidders[bidder_idx] };
-        // no heap for diagonal bidders
-        if ( bidder.is_diagonal() ) {
-            losses_heap.push_back( nullptr );
-            losses_heap_handles.push_back(LossesHeapRHandleVec());
-            items_indices_for_heap_handles.push_back( std::vector<size_t>() );
-            continue;
-        } else {
-            losses_heap.push_back( new LossesHeapR() );
-
-            assert( losses_heap.at(bidder_idx) != nullptr );
-
-            items_indices_for_heap_handles.push_back( std::vector<size_t>(this->items.size(), k_invalid_index) );
-            LossesHeapRHandleVec handles_vec;
-            losses_heap_handles.push_back(handles_vec);
-            size_t handle_idx { 0 };
-            for(size_t item_idx = 0; item_idx < this->items.size(); ++item_idx) {
-                assert( items_indices_for_heap_handles.at(bidder_idx).at(item_idx) > 0 );
-                DiagramPoint<Real> item { this->items[item_idx] };
-                if ( item.is_normal() ) {
-                    // item can be assigned to bidder, store in heap
-                    IdxValPair<Real> vp { item_idx, weight_matrix[bidder_idx][item_idx] + this->prices[item_idx] };
-                    losses_heap_handles[bidder_idx].push_back(  losses_heap[bidder_idx]->push(vp) );
-                    // keep corresponding index in items_indices_for_heap_handles
-                    items_indices_for_heap_handles[bidder_idx][item_idx] = handle_idx++;
-                }
-            }
-        }
+
+template<class Real_, class PointContainer_>
+void AuctionOracleLazyHeapRestricted<Real_, PointContainer_>::recompute_best_diagonal_items()
+{
+    auto iter = diag_items_heap_.ordered_begin();
+    best_diagonal_item_idx_ = iter->first;
+    best_diagonal_item_value_ = iter->second - price_shift_;
+    ++iter;
+    second_best_diagonal_item_value_ = iter == diag_items_heap_.ordered_end() ? std::numeric_limits<Real>::max() : iter->second - price_shift_;
+    best_diagonal_items_computed_ = true;
+}
+
+
+template<class Real_, class PointContainer_>
+IdxValPair<Real_> AuctionOracleLazyHeapRestricted<Real_, PointContainer_>::get_optimal_bid(const IdxType bidder_idx)
+{
+    // corresponding point is always considered as a candidate
+    // if bidder is a diagonal point, proj_item is a normal point,
+    // and vice versa.
+    size_t proj_item_idx = bidder_idx;
+    assert(proj_item_idx < this->items.size());
+    assert(this->items[proj_item_idx].type != this->bidders[bidder_idx].type);
+    Real proj_item_value = this->get_value_for_bidder(bidder_idx, proj_item_idx);
+
+    IdxValPair<Real> best_other;
+    Real second_best_other_value;
+    if (this->bidders[bidder_idx].is_diagonal()) {
+        if (not best_diagonal_items_computed_)
+            recompute_best_diagonal_items();
+        best_other = std::make_pair(best_diagonal_item_idx_, best_diagonal_item_value_);
+        second_best_other_value = second_best_diagonal_item_value_;
+    } else {
+        auto two_best = get_two_best_normal_items(bidder_idx);
+        best_other = two_best.first;
+        second_best_other_value = two_best.second;
     }
+
+    size_t best_item_idx;
+    Real best_item_value;
+    Real second_best_item_value;
+    if (proj_item_value < best_other.second) {
+        best_item_idx = proj_item_idx;
+        best_item_value = proj_item_value;
+        second_best_item_value = best_other.second;
+    } else if (proj_item_value < second_best_other_value) {
+        best_item_idx = best_other.first;
+        best_item_value = best_other.second;
+        second_best_item_value = proj_item_value;
+    } else {
+        best_item_idx = best_other.first;
+        best_item_value = best_other.second;
+        second_best_item_value = second_best_other_value;
+    }
+
+    assert(second_best_item_value >= best_item_value);
+
+    IdxValPair<Real> result;
+    result.first = best_item_idx;
+    result.second = ( second_best_item_value - best_item_value ) + this->prices[best_item_idx] + this->epsilon;
+    return result;
 }
 
 
-template<class Real>
-AuctionOracleLazyHeapRestricted<Real>::~AuctionOracleLazyHeapRestricted()
+// smallest value (cost + price) over all items the bidder can get,
+// same candidates as in get_optimal_bid
+template<class Real_, class PointContainer_>
+Real_ AuctionOracleLazyHeapRestricted<Real_, PointContainer_>::get_best_item_value(const IdxType bidder_idx)
 {
-    for(auto h : losses_heap) {
-        delete h;
+    Real proj_item_value = this->get_value_for_bidder(bidder_idx, bidder_idx);
+    if (this->bidders[bidder_idx].is_diagonal()) {
+        if (not best_diagonal_items_computed_)
+            recompute_best_diagonal_items();
+        return std::min(proj_item_value, best_diagonal_item_value_);
+    } else {
+        return std::min(proj_item_value, get_two_best_normal_items(bidder_idx).first.second);
     }
 }
 
 
-template<class Real>
-void AuctionOracleLazyHeapRestricted<Real>::set_price(IdxType item_idx, Real new_price)
+template<class Real_, class PointContainer_>
+void AuctionOracleLazyHeapRestricted<Real_, PointContainer_>::set_price(const IdxType item_idx,
+                                                                       const Real new_price,
+                                                                       const bool)
 {
-    assert( this->prices.at(item_idx) < new_price );
-#ifdef DEBUG_AUCTION
-    std::cout << "price incremented by " <<  this->prices.at(item_idx) - new_price << std::endl;
-#endif
     this->prices[item_idx] = new_price;
-    if (this->items[item_idx].is_normal() ) {
-        // lazy: record the moment we updated the price of the items,
-        // do not update queues.
-        // 1. move the items with updated price to the front of the update_list,
-        update_list.splice(update_list.begin(), update_list, items_iterators[item_idx]);
-        // 2. record the moment we updated the price and increase the counter
-        update_list.front().second = update_counter++;
+    if (this->items[item_idx].is_normal()) {
+        // lazy: move the item to the front of update_list_
+        // and record the moment of the change, heaps are not touched
+        size_t pos = normal_item_positions_[item_idx];
+        update_list_.splice(update_list_.begin(), update_list_, items_iterators_[pos]);
+        update_list_.front().second = update_counter_++;
     } else {
-        // diagonal items are stored in one heap
-        diag_items_heap.decrease(diag_heap_handles[heap_handles_indices[item_idx]], std::make_pair(item_idx, new_price));
-        best_diagonal_items_computed = false;
+        diag_items_heap_.update(diag_heap_handles_[heap_handles_indices_[item_idx]], std::make_pair(item_idx, new_price + price_shift_));
+        best_diagonal_items_computed_ = false;
     }
 }
 
+
 template<class Real_, class PointContainer_>
 void AuctionOracleLazyHeapRestricted<Real_, PointContainer_>::set_prices(const std::vector<Real_>& new_prices)
 {
@@ -194,282 +244,39 @@ void AuctionOracleLazyHeapRestricted<Real_, PointContainer_>::set_prices(const s
         set_price(item_idx, new_prices[item_idx]);
 }
 
-// subtract min. price from all prices
-template<class Real>
-void AuctionOracleLazyHeapRestricted<Real>::adjust_prices()
+template<class Real_, class PointContainer_>
+void AuctionOracleLazyHeapRestricted<Real_, PointContainer_>::set_prices(const std::vector<IdxValPair<Real_>>& new_prices)
 {
+    for(const auto& item_price : new_prices)
+        set_price(item_price.first, item_price.second);
 }
 
 
-template<class Real>
-DebugOptimalBid<Real> AuctionOracleLazyHeapRestricted<Real>::get_optimal_bid_debug(IdxType bidder_idx)
+// subtracting delta from all prices does not change the order in any heap,
+// so only the shift is recorded
+template<class Real_, class PointContainer_>
+void AuctionOracleLazyHeapRestricted<Real_, PointContainer_>::adjust_prices(const Real delta)
 {
-    DebugOptimalBid<Real> result;
-    assert(bidder_idx >=0 and bidder_idx < static_cast<IdxType>(this->bidders.size()) );
+    if (delta == 0.0)
+        return;
 
-    auto bidder = this->bidders[bidder_idx];
-    std::vector<IdxValPair<Real>> cand_items;
-    // corresponding point is always considered as a candidate
-
-    size_t proj_item_idx = bidder_idx;
-    assert( 0 <= proj_item_idx and proj_item_idx < this->items.size() );
-    auto proj_item = this->items[proj_item_idx];
-    assert(proj_item.type != bidder.type);
-    //assert(proj_item.proj_id == bidder.id);
-    //assert(proj_item.id == bidder.proj_id);
-    // todo: store precomputed distance?
-    Real proj_item_value = this->get_value_for_bidder(bidder_idx, proj_item_idx);
-    cand_items.push_back( std::make_pair(proj_item_idx, proj_item_value) );
-
-    if (bidder.is_normal()) {
-        assert(losses_heap.at(bidder_idx) != nullptr);
-        assert(losses_heap[bidder_idx]->size() >= 2);
-        update_queue_for_bidder(bidder_idx);
-        auto pHeap = losses_heap[bidder_idx];
-        assert( pHeap != nullptr );
-        auto top_iter = pHeap->ordered_begin();
-        cand_items.push_back( *top_iter );
-        ++top_iter; // now points to the second-best items
-        cand_items.push_back( *top_iter );
-        std::sort(cand_items.begin(), cand_items.end(), CompPairsBySecondStruct<Real>());
-        assert(cand_items[1].second >= cand_items[0].second);
-    } else {
-        // for diagonal bidder the only normal point has already been added
-        // the other 2 candidates are diagonal items only, get from the heap
-        // with prices
-        assert(diag_items_heap.size() > 1);
-        auto top_diag_iter = diag_items_heap.ordered_begin();
-        auto topDiag1 = *top_diag_iter++;
-        auto topDiag2 = *top_diag_iter;
-        cand_items.push_back(topDiag1);
-        cand_items.push_back(topDiag2);
-        std::sort(cand_items.begin(), cand_items.end(), CompPairsBySecondStruct<Real>());
-        assert(cand_items.size() == 3);
-        assert(cand_items[2].second >= cand_items[1].second);
-        assert(cand_items[1].second >= cand_items[0].second);
+    for(auto& p : this->prices) {
+        p -= delta;
     }
-
-    result.best_item_idx = cand_items[0].first;
-    result.second_best_item_idx = cand_items[1].first;
-    result.best_item_value = cand_items[0].second;
-    result.second_best_item_value = cand_items[1].second;
-
-    // checking code
-
-    //DebugOptimalBid<Real> debug_my_result(result);
-    //DebugOptimalBid<Real> debug_naive_result;
-    //debug_naive_result.best_item_value = 1e20;
-    //debug_naive_result.second_best_item_value = 1e20;
-    //Real curr_item_value;
-    //for(size_t item_idx = 0; item_idx < this->items.size(); ++item_idx) {
-        //if ( this->bidders[bidder_idx].type != this->items[item_idx].type and
-                //this->bidders[bidder_idx].proj_id != this->items[item_idx].id)
-            //continue;
-
-        //curr_item_value = pow(dist_lp(this->bidders[bidder_idx], this->items[item_idx]), wasserstein_power) + this->prices[item_idx];
-        //if (curr_item_value < debug_naive_result.best_item_value) {
-            //debug_naive_result.best_item_value = curr_item_value;
-            //debug_naive_result.best_item_idx  = item_idx;
-        //}
-    //}
-
-    //for(size_t item_idx = 0; item_idx < this->items.size(); ++item_idx) {
-        //if (item_idx == debug_naive_result.best_item_idx) {
-            //continue;
-        //}
-        //if ( this->bidders[bidder_idx].type != this->items[item_idx].type and
-                //this->bidders[bidder_idx].proj_id != this->items[item_idx].id)
-            //continue;
-
-        //curr_item_value = pow(dist_lp(this->bidders[bidder_idx], this->items[item_idx]), wasserstein_power) + this->prices[item_idx];
-        //if (curr_item_value < debug_naive_result.second_best_item_value) {
-            //debug_naive_result.second_best_item_value = curr_item_value;
-            //debug_naive_result.second_best_item_idx = item_idx;
-        //}
-    //}
-
-    //if ( fabs( debug_my_result.best_item_value - debug_naive_result.best_item_value ) > 1e-6 or
-            //fabs( debug_naive_result.second_best_item_value - debug_my_result.second_best_item_value) > 1e-6 ) {
-        //std::cerr << "bidder_idx = " << bidder_idx << "; ";
-        //std::cerr << this->bidders[bidder_idx] << std::endl;
-        //for(size_t item_idx = 0; item_idx < this->items.size(); ++item_idx) {
-            //std::cout << item_idx << ": " << this->items[item_idx] << "; price = " << this->prices[item_idx] << std::endl;
-        //}
-        //std::cerr << "debug_my_result: " << debug_my_result << std::endl;
-        //std::cerr << "debug_naive_result: " << debug_naive_result << std::endl;
-        //auto pHeap = losses_heap[bidder_idx];
-        //assert( pHeap != nullptr );
-        //for(auto top_iter = pHeap->ordered_begin(); top_iter != pHeap->ordered_end(); ++top_iter) {
-            //std::cerr << "in heap: " << top_iter->first << ": " << top_iter->second << "; real value = " << dist_lp(bidder, this->items[top_iter->first]) + this->prices[top_iter->first] << std::endl;
-        //}
-        //for(auto ci : cand_items) {
-            //std::cout << "ci.idx = " << ci.first << ", value = " << ci.second << std::endl;
-        //}
-
-        ////std::cerr << "two_best_items: " << two_best_items[0].d << " " << two_best_items[1].d << std::endl;
-        //assert(false);
-    //}
-
-
-    //std::cout << "get_optimal_bid: bidder_idx = " << bidder_idx << "; best_item_idx = " << best_item_idx << "; best_item_value = " << best_item_value << "; best_items_price = " << this->prices[best_item_idx] << "; second_best_item_idx = " << top_iter->first << "; second_best_value = " << second_best_item_value << "; second_best_price = " << this->prices[top_iter->first] <<  "; bid = " << this->prices[best_item_idx] + ( best_item_value - second_best_item_value ) + epsilon << "; epsilon = " << epsilon << std::endl;
-    //std::cout << "get_optimal_bid: bidder_idx = " << bidder_idx << "; best_item_idx = " << best_item_idx << "; best_items_dist= " << (weight_adj_const -  best_item_value) << "; best_items_price = " << this->prices[best_item_idx] << "; second_best_item_idx = " << top_iter->first << "; second_best_dist= " << (weight_adj_const - second_best_item_value) << "; second_best_price = " << this->prices[top_iter->first] <<  "; bid = " << this->prices[best_item_idx] + ( best_item_value - second_best_item_value ) + epsilon << "; epsilon = " << epsilon << std::endl;
-
-    return result;
+    price_shift_ += delta;
+    best_diagonal_items_computed_ = false;
 }
 
 
-template<class Real>
-IdxValPair<Real> AuctionOracleLazyHeapRestricted<Real>::get_optimal_bid(const IdxType bidder_idx)
+template<class Real_, class PointContainer_>
+void AuctionOracleLazyHeapRestricted<Real_, PointContainer_>::adjust_prices()
 {
-    IdxType best_item_idx;
-    //IdxType second_best_item_idx;
-    Real best_item_value;
-    Real second_best_item_value;
-
-    auto& bidder = this->bidders[bidder_idx];
-    IdxType proj_item_idx = bidder_idx;
-    assert( 0 <= proj_item_idx and proj_item_idx < this->items.size() );
-    auto proj_item = this->items[proj_item_idx];
-    assert(proj_item.type != bidder.type);
-    //assert(proj_item.proj_id == bidder.id);
-    //assert(proj_item.id == bidder.proj_id);
-    // todo: store precomputed distance?
-    Real proj_item_value = this->get_value_for_bidder(bidder_idx, proj_item_idx);
-
-    if (bidder.is_diagonal()) {
-        // for diagonal bidder the only normal point has already been added
-        // the other 2 candidates are diagonal items only, get from the heap
-        // with prices
-        assert(diag_items_heap.size() > 1);
-        if (!best_diagonal_items_computed) {
-            auto top_diag_iter = diag_items_heap.ordered_begin();
-            best_diagonal_item_idx = top_diag_iter->first;
-            best_diagonal_item_value = top_diag_iter->second;
-            top_diag_iter++;
-            second_best_diagonal_item_idx = top_diag_iter->first;
-            second_best_diagonal_item_value = top_diag_iter->second;
-            best_diagonal_items_computed = true;
-        }
-
-        if ( proj_item_value < best_diagonal_item_value) {
-            best_item_idx = proj_item_idx;
-            best_item_value = proj_item_value;
-            second_best_item_value = best_diagonal_item_value;
-            //second_best_item_idx = best_diagonal_item_idx;
-        } else if (proj_item_value < second_best_diagonal_item_value) {
-            best_item_idx = best_diagonal_item_idx;
-            best_item_value = best_diagonal_item_value;
-            second_best_item_value = proj_item_value;
-            //second_best_item_idx = proj_item_idx;
-        } else {
-            best_item_idx = best_diagonal_item_idx;
-            best_item_value = best_diagonal_item_value;
-            second_best_item_value = second_best_diagonal_item_value;
-            //second_best_item_idx = second_best_diagonal_item_idx;
-        }
-    } else {
-        // for normal bidder get 2 best items among non-diagonal (=normal) points
-        // from the corresponding heap
-        assert(diag_items_heap.size() > 1);
-        update_queue_for_bidder(bidder_idx);
-        auto top_norm_iter = losses_heap[bidder_idx]->ordered_begin();
-        IdxType best_normal_item_idx { top_norm_iter->first };
-        Real best_normal_item_value { top_norm_iter->second };
-        top_norm_iter++;
-        Real second_best_normal_item_value { top_norm_iter->second };
-        //IdxType second_best_normal_item_idx { top_norm_iter->first };
-
-        if ( proj_item_value < best_normal_item_value) {
-            best_item_idx = proj_item_idx;
-            best_item_value = proj_item_value;
-            second_best_item_value = best_normal_item_value;
-            //second_best_item_idx = best_normal_item_idx;
-        } else if (proj_item_value < second_best_normal_item_value) {
-            best_item_idx = best_normal_item_idx;
-            best_item_value = best_normal_item_value;
-            second_best_item_value = proj_item_value;
-            //second_best_item_idx = proj_item_idx;
-        } else {
-            best_item_idx = best_normal_item_idx;
-            best_item_value = best_normal_item_value;
-            second_best_item_value = second_best_normal_item_value;
-            //second_best_item_idx = second_best_normal_item_idx;
-        }
-    }
-
-    IdxValPair<Real> result;
-
-    assert( second_best_item_value >= best_item_value );
-
-    result.first = best_item_idx;
-    result.second = ( second_best_item_value - best_item_value ) + this->prices[best_item_idx] + this->epsilon;
-
-
-    // checking code
-
-    //DebugOptimalBid<Real> debug_my_result;
-    //debug_my_result.best_item_idx = best_item_idx;
-    //debug_my_result.best_item_value = best_item_value;
-    //debug_my_result.second_best_item_idx = second_best_item_idx;
-    //debug_my_result.second_best_item_value = second_best_item_value;
-    //DebugOptimalBid<Real> debug_naive_result;
-    //debug_naive_result.best_item_value = 1e20;
-    //debug_naive_result.second_best_item_value = 1e20;
-    //Real curr_item_value;
-    //for(size_t item_idx = 0; item_idx < this->items.size(); ++item_idx) {
-        //if ( this->bidders[bidder_idx].type != this->items[item_idx].type and
-                //this->bidders[bidder_idx].proj_id != this->items[item_idx].id)
-            //continue;
-
-        //curr_item_value = this->get_value_for_bidder(bidder_idx, item_idx);
-        //if (curr_item_value < debug_naive_result.best_item_value) {
-            //debug_naive_result.best_item_value = curr_item_value;
-            //debug_naive_result.best_item_idx  = item_idx;
-        //}
-    //}
-
-    //for(size_t item_idx = 0; item_idx < this->items.size(); ++item_idx) {
-        //if (item_idx == debug_naive_result.best_item_idx) {
-            //continue;
-        //}
-        //if ( this->bidders[bidder_idx].type != this->items[item_idx].type and
-                //this->bidders[bidder_idx].proj_id != this->items[item_idx].id)
-            //continue;
-
-        //curr_item_value = this->get_value_for_bidder(bidder_idx, item_idx);
-        //if (curr_item_value < debug_naive_result.second_best_item_value) {
-            //debug_naive_result.second_best_item_value = curr_item_value;
-            //debug_naive_result.second_best_item_idx = item_idx;
-        //}
-    //}
-    ////std::cout << "got naive result" << std::endl;
-
-    //if ( fabs( debug_my_result.best_item_value - debug_naive_result.best_item_value ) > 1e-6 or
-            //fabs( debug_naive_result.second_best_item_value - debug_my_result.second_best_item_value) > 1e-6 ) {
-        //std::cerr << "bidder_idx = " << bidder_idx << "; ";
-        //std::cerr << this->bidders[bidder_idx] << std::endl;
-        //for(size_t item_idx = 0; item_idx < this->items.size(); ++item_idx) {
-            //std::cout << item_idx << ": " << this->items[item_idx] << "; price = " << this->prices[item_idx] << std::endl;
-        //}
-        //std::cerr << "debug_my_result: " << debug_my_result << std::endl;
-        //std::cerr << "debug_naive_result: " << debug_naive_result << std::endl;
-        //auto pHeap = losses_heap[bidder_idx];
-        //if ( pHeap != nullptr ) {
-            //for(auto top_iter = pHeap->ordered_begin(); top_iter != pHeap->ordered_end(); ++top_iter) {
-                //std::cerr << "in heap: " << top_iter->first << ": " << top_iter->second << "; real value = " << dist_lp(bidder, this->items[top_iter->first]) + this->prices[top_iter->first] << std::endl;
-            //}
-        //}
-        ////for(auto ci : cand_items) {
-            ////std::cout << "ci.idx = " << ci.first << ", value = " << ci.second << std::endl;
-        ////}
-
-        ////std::cerr << "two_best_items: " << two_best_items[0].d << " " << two_best_items[1].d << std::endl;
-        //assert(false);
-    // }
-    //std::cout << "get_optimal_bid: bidder_idx = " << bidder_idx << "; best_item_idx = " << best_item_idx << "; best_item_value = " << best_item_value << "; best_items_price = " << this->prices[best_item_idx] << "; second_best_item_idx = " << top_iter->first << "; second_best_value = " << second_best_item_value << "; second_best_price = " << this->prices[top_iter->first] <<  "; bid = " << this->prices[best_item_idx] + ( best_item_value - second_best_item_value ) + epsilon << "; epsilon = " << epsilon << std::endl;
-    //std::cout << "get_optimal_bid: bidder_idx = " << bidder_idx << "; best_item_idx = " << best_item_idx << "; best_items_dist= " << (weight_adj_const -  best_item_value) << "; best_items_price = " << this->prices[best_item_idx] << "; second_best_item_idx = " << top_iter->first << "; second_best_dist= " << (weight_adj_const - second_best_item_value) << "; second_best_price = " << this->prices[top_iter->first] <<  "; bid = " << this->prices[best_item_idx] + ( best_item_value - second_best_item_value ) + epsilon << "; epsilon = " << epsilon << std::endl;
-
-    return result;
+    if (this->prices.empty())
+        return;
+    adjust_prices(*std::min_element(this->prices.begin(), this->prices.end()));
 }
 
-} // end of namespace ws
+} // ws
+} // hera
+
+#endif
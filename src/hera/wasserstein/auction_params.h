@@ -12,6 +12,10 @@
 
 namespace hera {
 
+// oracle of the Gauss-Seidel auction for persistence diagrams;
+// automatic picks one from the size and spread of the diagrams
+enum class AuctionOracleType { automatic, kdtree, lazy_heap };
+
 template<class Real_ = double>
 struct AuctionParams {
     using Real = Real_;
@@ -20,9 +24,14 @@ struct AuctionParams {
     Real internal_p {get_infinity<Real>()};
     Real initial_epsilon {0}; // 0.0 means maxVal / 4.0
     Real epsilon_common_ratio {5};
+    bool adaptive_epsilon {false}; // start from the trivial matching bound, pick next epsilon from the last phase
+    bool remove_duplicates {false}; // match points present in both diagrams to each other before the auction, exact for wasserstein_power == 1
+    Real prune_error_budget {0}; // drop low-persistence points adding at most this to the error of the distance; 0 means no pruning
+    AuctionOracleType oracle_type {AuctionOracleType::automatic}; // see ws::use_lazy_heap_oracle
     int max_num_phases {std::numeric_limits<decltype(max_num_phases)>::max()};
     int max_bids_per_round {1};  // imitate Gauss-Seidel is default behaviour
     unsigned int dim {2}; // for pure geometric version only; ignored in persistence diagrams
+    Real deletion_cost {-1}; // for pure geometric version only: if >= 0, partial matching where each unmatched point costs deletion_cost^wasserstein_power; negative means a perfect matching
     bool tolerate_max_iter_exceeded {false}; // whether auction should throw an exception on max. iterations exceeded
     bool return_matching {false}; // whether to return optimal matching along with cost
     bool match_inf_points {true}; // whether to add infinite points to matching; ignored, if return_matching is false
@@ -37,6 +46,11 @@ std::ostream& operator<<(std::ostream& out, const AuctionParams<Real>& p)
     else
         out << p.internal_p;
     out << ", initial_epsilon=" << p.initial_epsilon << ", epsilon_common_ratio=" << p.epsilon_common_ratio;
+    out << ", adaptive_epsilon=" << std::boolalpha << p.adaptive_epsilon << std::noboolalpha;
+    out << ", remove_duplicates=" << std::boolalpha << p.remove_duplicates << std::noboolalpha;
+    out << ", prune_error_budget=" << p.prune_error_budget;
+    out << ", oracle_type=" << static_cast<int>(p.oracle_type);
+    out << ", deletion_cost=" << p.deletion_cost;
     out << ", max_num_phases=" << p.max_num_phases << ", max_bids_per_round=" << p.max_bids_per_round;
     out << std::boolalpha;
     out << ", tolerate_max_iter_exceeded=" << p.tolerate_max_iter_exceeded;
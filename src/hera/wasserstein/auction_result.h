@@ -1,9 +1,11 @@
 #ifndef HERA_AUCTION_RESULT_H
 #define HERA_AUCTION_RESULT_H
 
-#include <unordered_map>
+#include <algorithm>
 #include <cmath>
 #include <ostream>
+#include <utility>
+#include <vector>
 
 #include "../common.h"
 
@@ -19,11 +21,19 @@ struct AuctionResult {
     long int num_rounds {0};        // total number of bidding rounds in all phases
     int num_phases {0};             // number of epsilon-scaling phases
     std::vector<Real> prices;       // final prices
+    int num_pruned_points {0};      // low-persistence points matched to the diagonal without auction
+    Real prune_error_bound {0};     // bound on the error of distance caused by pruning
 
     void compute_distance(Real q)  { distance = std::pow(cost, 1/ q); }
 
-    std::unordered_map<int, int> matching_a_to_b_;
-    std::unordered_map<int, int> matching_b_to_a_;
+    // matching, keyed by dense point ids (positions in the input diagrams):
+    // matching_a_to_b_[a] is the id of the B-point matched to a,
+    // or k_diagonal if a goes to the diagonal; likewise for matching_b_to_a_.
+    // Negative ids (diagonal projections) are not stored.
+    static constexpr int k_diagonal = -1;
+
+    std::vector<int> matching_a_to_b_;
+    std::vector<int> matching_b_to_a_;
 
     void clear_matching()
     {
@@ -31,11 +41,36 @@ struct AuctionResult {
         matching_b_to_a_.clear();
     }
 
+    // grow the matching to cover n_a points of A and n_b points of B,
+    // new points are matched to the diagonal
+    void resize_matching(size_t n_a, size_t n_b)
+    {
+        if (matching_a_to_b_.size() < n_a)
+            matching_a_to_b_.resize(n_a, k_diagonal);
+        if (matching_b_to_a_.size() < n_b)
+            matching_b_to_a_.resize(n_b, k_diagonal);
+    }
+
     void add_to_matching(int a, int b)
     {
-        assert(matching_a_to_b_.count(a) == 0 and matching_b_to_a_.count(b) == 0);
-        matching_a_to_b_[a] = b;
-        matching_b_to_a_[b] = a;
+        if (a >= 0 and b >= 0) {
+            resize_matching(a + 1, b + 1);
+            assert(matching_a_to_b_[a] == k_diagonal and matching_b_to_a_[b] == k_diagonal);
+            matching_a_to_b_[a] = b;
+            matching_b_to_a_[b] = a;
+        }
+    }
+
+    // copy the non-diagonal edges of other into this matching
+    void merge_matching(const AuctionResult& other)
+    {
+        resize_matching(other.matching_a_to_b_.size(), other.matching_b_to_a_.size());
+        for(size_t a = 0; a < other.matching_a_to_b_.size(); ++a)
+            if (other.matching_a_to_b_[a] != k_diagonal)
+                matching_a_to_b_[a] = other.matching_a_to_b_[a];
+        for(size_t b = 0; b < other.matching_b_to_a_.size(); ++b)
+            if (other.matching_b_to_a_[b] != k_diagonal)
+                matching_b_to_a_[b] = other.matching_b_to_a_[b];
     }
 };
 
@@ -49,20 +84,33 @@ std::ostream& operator<<(std::ostream& out, const AuctionResult<Real>& r)
 }
 
 
+// r1 and r2 are taken by value, pass temporaries to move their prices and
+// matchings into the result instead of copying them
 template<class Real>
-AuctionResult<Real> add_results(const AuctionResult<Real>& r1, const AuctionResult<Real>& r2, Real q)
+AuctionResult<Real> add_results(AuctionResult<Real> r1, AuctionResult<Real> r2, Real q)
 {
     AuctionResult<Real> result;
     result.cost = r1.cost + r2.cost;
     result.compute_distance(q);
     result.num_rounds = r1.num_rounds + r2.num_rounds;
     result.num_phases = r1.num_phases + r2.num_phases;
-
-    result.matching_a_to_b_ = r1.matching_a_to_b_;
-    result.matching_a_to_b_.insert(r2.matching_a_to_b_.begin(), r2.matching_a_to_b_.end());
-
-    result.matching_b_to_a_ = r1.matching_b_to_a_;
-    result.matching_b_to_a_.insert(r2.matching_b_to_a_.begin(), r2.matching_b_to_a_.end());
+    result.num_pruned_points = r1.num_pruned_points + r2.num_pruned_points;
+    result.prune_error_bound = std::max(r1.prune_error_bound, r2.prune_error_bound);
+
+    // at most one of the results comes from an auction, keep its prices
+    // and epsilons so that they can be used to warm-start the next auction
+    AuctionResult<Real>& auction_r = r2.prices.empty() ? r1 : r2;
+    result.prices = std::move(auction_r.prices);
+    result.start_epsilon = auction_r.start_epsilon;
+    result.final_epsilon = auction_r.final_epsilon;
+
+    // the matchings are disjoint: keep the larger one and merge the other into it
+    bool r1_is_larger = r1.matching_a_to_b_.size() + r1.matching_b_to_a_.size() >=
+                        r2.matching_a_to_b_.size() + r2.matching_b_to_a_.size();
+    AuctionResult<Real>& larger_r = r1_is_larger ? r1 : r2;
+    result.matching_a_to_b_ = std::move(larger_r.matching_a_to_b_);
+    result.matching_b_to_a_ = std::move(larger_r.matching_b_to_a_);
+    result.merge_matching(r1_is_larger ? r2 : r1);
 
     // we add only results from matching infinite points, where relative error is 0, to finite
     // TODO: fix this, now it is an upper bound
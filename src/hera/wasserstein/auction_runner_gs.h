@@ -65,10 +65,11 @@ public:
     void enable_logging(const char* log_filename, const size_t _max_unassigned_to_log);
 
     int get_bidder_id(size_t bidder_idx) const { return bidders[bidder_idx].get_id(); }
-    int get_bidders_item_id(size_t bidder_idx) const { return items[bidders_to_items[bidder_idx]].get_id(); }
+    int get_bidders_item_id(size_t bidder_idx) const;
 
     void run_auction();
-    Result get_result() const { return result; }
+    const Result& get_result() const { return result; }
+    Result& get_result() { return result; }
 private:
     // private data
     PointContainer bidders, items;
@@ -80,6 +81,25 @@ private:
     Params params;
     Result result;
 
+#ifndef WASSERSTEIN_PURE_GEOM
+    // cost of the partial matching, persistence and prices of unmatched points,
+    // to stop a phase once matching the rest to the diagonal is good enough
+    Real partial_cost {0.0};
+    std::vector<Real> bidders_cost_to_diagonal;
+    std::vector<Real> items_cost_to_diagonal;
+    std::vector<Real> bidders_edge_cost;
+    Real unassigned_items_prices {0.0};
+    Real max_cost_ratio {0.0};
+    Real total_bidders_persistence {0.0};
+    Real total_items_persistence {0.0};
+    Real unassigned_bidders_persistence {0.0};
+    Real unassigned_items_persistence {0.0};
+    bool phase_stopped_early {false};
+    // bidders paired with a normal item only to complete the matching, both
+    // points go to the diagonal
+    std::vector<char> bidders_sent_to_diagonal;
+#endif
+
     // to get the 2 best items
     AuctionOracle oracle;
     std::unordered_set<size_t> unassigned_bidders;
@@ -89,6 +109,16 @@ private:
     void run_auction_phases();
     void run_auction_phase();
     void flush_assignment();
+    Real get_trivial_matching_cost() const;
+    Real get_duality_gap();
+#ifndef WASSERSTEIN_PURE_GEOM
+    Real get_cost_to_diagonal(const DgmPoint& pt) const;
+    Real get_partial_cost_upper_bound() const;
+    Real get_partial_cost_lower_bound() const;
+    bool is_partial_matching_done();
+    void complete_matching_to_diagonal();
+#endif
+    Real get_next_epsilon_ratio(const long int phase_rounds, Real& ratio) const;
     // return 0, if item_idx is invalid
     Real get_item_bidder_cost(const size_t item_idx, const size_t bidder_idx, const bool tolerate_invalid_idx = false) const;
 
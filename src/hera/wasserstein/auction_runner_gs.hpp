@@ -72,12 +72,33 @@ AuctionRunnerGS<R, AO, PC>::AuctionRunnerGS(const PC& A,
     if (params.epsilon_common_ratio == 0)
         params.epsilon_common_ratio = 5;
 
-    if (params.initial_epsilon == 0)
+    if (params.initial_epsilon == 0) {
         params.initial_epsilon = oracle.max_val_ / 4;
+        // the first phase cannot do better than some perfect matching,
+        // so an error of num_bidders * epsilon of that cost is enough
+        if (params.adaptive_epsilon and prices.empty()) {
+            Real trivial_cost = get_trivial_matching_cost();
+            if (trivial_cost > 0)
+                params.initial_epsilon = std::min(params.initial_epsilon, trivial_cost / num_bidders);
+        }
+    }
 
     assert(params.initial_epsilon > 0.0 );
     assert(params.epsilon_common_ratio > 0.0 );
     assert(A.size() == B.size());
+
+#ifndef WASSERSTEIN_PURE_GEOM
+    bidders_edge_cost.assign(num_bidders, 0.0);
+    for(const auto& bidder : bidders) {
+        bidders_cost_to_diagonal.push_back(get_cost_to_diagonal(bidder));
+        total_bidders_persistence += bidders_cost_to_diagonal.back();
+    }
+    for(const auto& item : items) {
+        items_cost_to_diagonal.push_back(get_cost_to_diagonal(item));
+        total_items_persistence += items_cost_to_diagonal.back();
+    }
+    max_cost_ratio = std::pow(1 + params.delta, params.wasserstein_power);
+#endif
 }
 
 template<class R, class AO, class PC>
@@ -100,6 +121,19 @@ void AuctionRunnerGS<R, AO, PC>::assign_item_to_bidder(const IdxType item_idx, c
         bidders_to_items[old_item_owner] = k_invalid_index;
         unassigned_bidders.insert(old_item_owner);
     }
+
+#ifndef WASSERSTEIN_PURE_GEOM
+    unassigned_bidders_persistence -= bidders_cost_to_diagonal[bidder_idx];
+    if (old_item_owner != k_invalid_index) {
+        unassigned_bidders_persistence += bidders_cost_to_diagonal[old_item_owner];
+        partial_cost -= bidders_edge_cost[old_item_owner];
+    } else {
+        unassigned_items_persistence -= items_cost_to_diagonal[item_idx];
+        unassigned_items_prices -= oracle.get_price(item_idx);
+    }
+    bidders_edge_cost[bidder_idx] = get_item_bidder_cost(item_idx, bidder_idx);
+    partial_cost += bidders_edge_cost[bidder_idx];
+#endif
 }
 
 
@@ -121,6 +155,134 @@ void AuctionRunnerGS<R, AO, PC>::flush_assignment()
     assert(unassigned_bidders.size() == bidders.size());
 
     oracle.adjust_prices();
+
+#ifndef WASSERSTEIN_PURE_GEOM
+    partial_cost = 0.0;
+    unassigned_bidders_persistence = total_bidders_persistence;
+    unassigned_items_persistence = total_items_persistence;
+    const auto& prices = oracle.get_prices();
+    unassigned_items_prices = std::accumulate(prices.begin(), prices.end(), Real(0.0));
+#endif
+}
+
+
+#ifndef WASSERSTEIN_PURE_GEOM
+template<class R, class AO, class PC>
+R AuctionRunnerGS<R, AO, PC>::get_cost_to_diagonal(const DgmPoint& pt) const
+{
+    return std::pow(pt.persistence_lp(params.internal_p), params.wasserstein_power);
+}
+
+
+// Matching the unassigned points to the diagonal gives a matching of the
+// diagrams of cost partial_cost + their persistence. The prices give the
+// lower bound sum_i min_j (c_ij + p_j) - sum_j p_j on the optimal cost, where
+// matched bidders are within epsilon of their item and unmatched ones
+// contribute at least the minimal price, which is 0 after adjust_prices.
+template<class R, class AO, class PC>
+R AuctionRunnerGS<R, AO, PC>::get_partial_cost_upper_bound() const
+{
+    return partial_cost + unassigned_bidders_persistence + unassigned_items_persistence;
+}
+
+
+template<class R, class AO, class PC>
+R AuctionRunnerGS<R, AO, PC>::get_partial_cost_lower_bound() const
+{
+    size_t num_assigned_bidders = num_bidders - unassigned_bidders.size();
+    return partial_cost - num_assigned_bidders * oracle.get_epsilon() - unassigned_items_prices;
+}
+
+
+// the running sums drift over many bids, so recompute them before stopping
+template<class R, class AO, class PC>
+bool AuctionRunnerGS<R, AO, PC>::is_partial_matching_done()
+{
+    Real lower_bound = get_partial_cost_lower_bound();
+    if (lower_bound <= 0 or get_partial_cost_upper_bound() > max_cost_ratio * lower_bound)
+        return false;
+
+    partial_cost = 0.0;
+    unassigned_bidders_persistence = 0.0;
+    unassigned_items_persistence = 0.0;
+    unassigned_items_prices = 0.0;
+    for(size_t bidder_idx = 0; bidder_idx < num_bidders; ++bidder_idx) {
+        if (bidders_to_items[bidder_idx] == k_invalid_index)
+            unassigned_bidders_persistence += bidders_cost_to_diagonal[bidder_idx];
+        else
+            partial_cost += bidders_edge_cost[bidder_idx];
+    }
+    for(size_t item_idx = 0; item_idx < num_items; ++item_idx) {
+        if (items_to_bidders[item_idx] == k_invalid_index) {
+            unassigned_items_persistence += items_cost_to_diagonal[item_idx];
+            unassigned_items_prices += oracle.get_price(item_idx);
+        }
+    }
+
+    lower_bound = get_partial_cost_lower_bound();
+    return lower_bound > 0 and get_partial_cost_upper_bound() <= max_cost_ratio * lower_bound;
+}
+
+
+// Give the unassigned bidders the unassigned items, preferring the bidder's
+// own projection and otherwise a diagonal partner. As a matching of diagrams
+// this sends every unassigned point to the diagonal, so its cost is
+// partial_cost plus the unassigned persistence; the pairs of normal points
+// left over are marked, get_bidders_item_id reports them as diagonal edges.
+template<class R, class AO, class PC>
+void AuctionRunnerGS<R, AO, PC>::complete_matching_to_diagonal()
+{
+    std::vector<IdxType> normal_items, diagonal_items;
+    for(size_t item_idx = 0; item_idx < num_items; ++item_idx) {
+        if (items_to_bidders[item_idx] != k_invalid_index)
+            continue;
+        size_t bidder_idx = item_idx;
+        if (bidders_to_items[bidder_idx] == k_invalid_index) {
+            bidders_to_items[bidder_idx] = item_idx;
+            items_to_bidders[item_idx] = bidder_idx;
+        } else if (items[item_idx].is_diagonal()) {
+            diagonal_items.push_back(item_idx);
+        } else {
+            normal_items.push_back(item_idx);
+        }
+    }
+
+    std::vector<IdxType> other_bidders;
+    for(size_t bidder_idx : unassigned_bidders) {
+        if (bidders_to_items[bidder_idx] != k_invalid_index)
+            continue;
+        auto& partners = bidders[bidder_idx].is_diagonal() ? normal_items : diagonal_items;
+        if (partners.empty()) {
+            other_bidders.push_back(bidder_idx);
+            continue;
+        }
+        bidders_to_items[bidder_idx] = partners.back();
+        items_to_bidders[partners.back()] = bidder_idx;
+        partners.pop_back();
+    }
+
+    normal_items.insert(normal_items.end(), diagonal_items.begin(), diagonal_items.end());
+    assert(normal_items.size() == other_bidders.size());
+    bidders_sent_to_diagonal.assign(num_bidders, false);
+    for(size_t k = 0; k < other_bidders.size(); ++k) {
+        bidders_to_items[other_bidders[k]] = normal_items[k];
+        items_to_bidders[normal_items[k]] = other_bidders[k];
+        bidders_sent_to_diagonal[other_bidders[k]] = true;
+    }
+
+    unassigned_bidders.clear();
+}
+#endif
+
+
+template<class R, class AO, class PC>
+int AuctionRunnerGS<R, AO, PC>::get_bidders_item_id(size_t bidder_idx) const
+{
+#ifndef WASSERSTEIN_PURE_GEOM
+    if (not bidders_sent_to_diagonal.empty() and bidders_sent_to_diagonal[bidder_idx])
+        return -1;
+#endif
+    return items[bidders_to_items[bidder_idx]].get_id();
 }
 
 
@@ -133,11 +295,33 @@ void AuctionRunnerGS<R, AO, PC>::run_auction_phases()
     result.start_epsilon = oracle.get_epsilon();
     result.final_epsilon = oracle.get_epsilon();
     assert( oracle.get_epsilon() > 0 );
+    Real epsilon_ratio = params.epsilon_common_ratio;
     for(int phase_num = 0; phase_num < params.max_num_phases; ++phase_num) {
         flush_assignment();
+        long int phase_rounds = result.num_rounds;
         run_auction_phase();
+        phase_rounds = result.num_rounds - phase_rounds;
+#ifndef WASSERSTEIN_PURE_GEOM
+        if (phase_stopped_early)
+            break;
+#endif
         Real current_result = getDistanceToQthPowerInternal();
+        if (current_result == 0) {
+            // costs are non-negative, a matching of zero cost is optimal;
+            // the relative error below cannot certify it, its denominator
+            // is never positive, and the phases would go on until
+            // max_num_phases
+            result.final_relative_error = 0;
+            break;
+        }
         Real denominator = current_result - num_bidders * oracle.get_epsilon();
+        if (params.adaptive_epsilon and denominator > 0) {
+            // the gap is worth computing only if it may meet the relative error
+            // where num_bidders * epsilon does not
+            Real target_gap = current_result * (1 - std::pow(1 + params.delta, -params.wasserstein_power));
+            if (num_bidders * oracle.get_epsilon() <= epsilon_ratio * target_gap)
+                denominator = std::max(denominator, current_result - get_duality_gap());
+        }
         current_result = std::pow(current_result, 1 / params.wasserstein_power);
 
         if ( denominator > 0 ) {
@@ -149,7 +333,10 @@ void AuctionRunnerGS<R, AO, PC>::run_auction_phases()
             }
         }
         // decrease epsilon for the next iteration
-        oracle.set_epsilon( oracle.get_epsilon() / params.epsilon_common_ratio );
+        if (params.adaptive_epsilon)
+            oracle.set_epsilon( oracle.get_epsilon() / get_next_epsilon_ratio(phase_rounds, epsilon_ratio) );
+        else
+            oracle.set_epsilon( oracle.get_epsilon() / params.epsilon_common_ratio );
         result.final_epsilon = oracle.get_epsilon();
     }
 
@@ -157,6 +344,52 @@ void AuctionRunnerGS<R, AO, PC>::run_auction_phases()
 }
 
 
+// cost of matching bidder i to item i; for persistence diagrams this sends
+// every point to its own diagonal projection
+template<class R, class AO, class PC>
+R AuctionRunnerGS<R, AO, PC>::get_trivial_matching_cost() const
+{
+    Real cost = 0.0;
+    for(size_t idx = 0; idx < num_bidders; ++idx) {
+        cost += get_item_bidder_cost(idx, idx);
+    }
+    return cost;
+}
+
+
+// Any prices give the lower bound sum_i min_j (c_ij + p_j) - sum_j p_j
+// on the optimal cost, so the current matching is off by at most the sum
+// of the bidders' slacks, usually far less than num_bidders * epsilon.
+template<class R, class AO, class PC>
+R AuctionRunnerGS<R, AO, PC>::get_duality_gap()
+{
+    Real gap = 0.0;
+    for(size_t bidder_idx = 0; bidder_idx < num_bidders; ++bidder_idx) {
+        IdxType item_idx = bidders_to_items[bidder_idx];
+        Real value = get_item_bidder_cost(item_idx, bidder_idx) + oracle.get_price(item_idx);
+        gap += std::max(Real(0.0), value - oracle.get_best_item_value(bidder_idx));
+    }
+    return gap;
+}
+
+
+// Late phases cost about the same number of bids per bidder whatever the
+// ratio, early ones with coarse prices far fewer: double the ratio while
+// phases stay cheap, and return to epsilon_common_ratio once they do not.
+template<class R, class AO, class PC>
+R AuctionRunnerGS<R, AO, PC>::get_next_epsilon_ratio(const long int phase_rounds, Real& ratio) const
+{
+    const Real max_ratio = 1000;
+    const Real cheap_bids_per_bidder = 4;
+
+    if (phase_rounds < cheap_bids_per_bidder * num_bidders)
+        ratio = std::min(max_ratio, 2 * ratio);
+    else
+        ratio = params.epsilon_common_ratio;
+    return ratio;
+}
+
+
 template<class R, class AO, class PC>
 void AuctionRunnerGS<R, AO, PC>::run_auction()
 {
@@ -201,6 +434,14 @@ void AuctionRunnerGS<R, AO, PC>::run_auction_phase()
         auto bid_value = optimal_bid.second;
         assign_item_to_bidder(optimal_bid.first, bidder_idx);
         oracle.set_price(optimal_item_idx, bid_value);
+#ifndef WASSERSTEIN_PURE_GEOM
+        if (not unassigned_bidders.empty() and is_partial_matching_done()) {
+            result.cost = get_partial_cost_upper_bound();
+            result.final_relative_error = std::pow(result.cost / get_partial_cost_lower_bound(), 1 / params.wasserstein_power) - 1;
+            complete_matching_to_diagonal();
+            phase_stopped_early = true;
+        }
+#endif
     } while (not unassigned_bidders.empty());
 
 #ifdef DEBUG_AUCTION
@@ -219,7 +460,12 @@ template<class R, class AO, class PC>
 R AuctionRunnerGS<R, AO, PC>::get_item_bidder_cost(const size_t item_idx, const size_t bidder_idx, const bool tolerate_invalid_idx) const
 {
     if (item_idx != k_invalid_index and bidder_idx != k_invalid_index) {
+#ifdef WASSERSTEIN_PURE_GEOM
+        // virtual points of a partial matching are known to the oracle
+        return oracle.get_cost(bidder_idx, item_idx);
+#else
         return std::pow(dist_lp(bidders[bidder_idx], items[item_idx], params.internal_p, params.dim), params.wasserstein_power);
+#endif
     } else {
         if (tolerate_invalid_idx)
             return R(0.0);
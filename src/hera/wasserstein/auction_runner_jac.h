@@ -93,6 +93,8 @@ private:
     Params params;
     Result result;
     std::vector<IdxValPairR> bid_table;
+    // new prices of the items assigned in a round, set at its end
+    std::vector<IdxValPairR> round_prices;
     // to get the 2 best items
     AuctionOracle oracle;
     std::unordered_set<size_t> unassigned_bidders;
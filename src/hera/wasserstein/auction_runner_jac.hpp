@@ -170,8 +170,13 @@ namespace ws {
     typename AuctionRunnerJac<R, AO, PC>::Real
     AuctionRunnerJac<R, AO, PC>::get_item_bidder_cost(const size_t item_idx, const size_t bidder_idx) const
     {
+#ifdef WASSERSTEIN_PURE_GEOM
+        // virtual points of a partial matching are known to the oracle
+        return oracle.get_cost(bidder_idx, item_idx);
+#else
         return std::pow(dist_lp(bidders[bidder_idx], items[item_idx], params.internal_p, params.dim),
                         params.wasserstein_power);
+#endif
     }
 
     template<class R, class AO, class PC>
@@ -180,7 +185,7 @@ namespace ws {
         assert(bid_table[item_idx].first != k_invalid_index);
         IdxValPairR best_bid{bid_table[item_idx]};
         assign_item_to_bidder(item_idx, best_bid.first);
-        oracle.set_price(item_idx, best_bid.second);
+        round_prices.emplace_back(item_idx, best_bid.second);
     }
 
     template<class R, class AO, class PC>
@@ -487,10 +492,12 @@ namespace ws {
             }
 #endif
 
-            // assignment
+            // assignment, prices are only read by bids and can be changed at once
+            round_prices.clear();
             for (auto item_idx : items_with_bids) {
                 assign_to_best_bidder(item_idx);
             }
+            oracle.set_prices(round_prices);
         } while (continue_auction_phase());
     }
 
@@ -23,13 +23,79 @@ namespace ws
     template <class Real>
     using DynamicPointVector = typename hera::ws::dnn::DynamicPointVector<Real>;
 
-    template <class Real>
-    using AuctionRunnerGSR = typename hera::ws::AuctionRunnerGS<Real, hera::ws::AuctionOracleKDTreePureGeom<Real>, hera::ws::dnn::DynamicPointVector<Real>>;
+    // D is the dimension of the points when it is known at compile time, 0 otherwise
+    template <class Real, size_t D = 0>
+    using AuctionOracleKDTreePureGeomR = typename hera::ws::AuctionOracleKDTreePureGeom<Real, hera::ws::dnn::DynamicPointVector<Real>, D>;
 
-    template <class Real>
-    using AuctionRunnerJacR = typename hera::ws::AuctionRunnerJac<Real, hera::ws::AuctionOracleKDTreePureGeom<Real>, hera::ws::dnn::DynamicPointVector<Real>>;
+    template <class Real, size_t D = 0>
+    using AuctionRunnerGSR = typename hera::ws::AuctionRunnerGS<Real, AuctionOracleKDTreePureGeomR<Real, D>, hera::ws::dnn::DynamicPointVector<Real>>;
+
+    template <class Real, size_t D = 0>
+    using AuctionRunnerJacR = typename hera::ws::AuctionRunnerJac<Real, AuctionOracleKDTreePureGeomR<Real, D>, hera::ws::dnn::DynamicPointVector<Real>>;
+
+template<size_t D>
+inline AuctionResult<double> run_pure_geom_auction(const DynamicPointVector<double>& set_A, const DynamicPointVector<double>& set_B, const AuctionParams<double>& params, const std::vector<double>& prices)
+{
+    if (params.max_bids_per_round == 1) {
+        hera::ws::AuctionRunnerGSR<double, D> auction(set_A, set_B, params, prices);
+        auction.run_auction();
+        return auction.get_result();
+    } else {
+        hera::ws::AuctionRunnerJacR<double, D> auction(set_A, set_B, params, prices);
+        auction.run_auction();
+        return auction.get_result();
+    }
+}
+
+
+// the kd-tree kernels of small dimensions are unrolled
+inline AuctionResult<double> run_pure_geom_auction(const DynamicPointVector<double>& set_A, const DynamicPointVector<double>& set_B, const AuctionParams<double>& params, const std::vector<double>& prices)
+{
+    switch (params.dim) {
+        case 1:
+            return run_pure_geom_auction<1>(set_A, set_B, params, prices);
+        case 2:
+            return run_pure_geom_auction<2>(set_A, set_B, params, prices);
+        case 3:
+            return run_pure_geom_auction<3>(set_A, set_B, params, prices);
+        case 4:
+            return run_pure_geom_auction<4>(set_A, set_B, params, prices);
+        default:
+            return run_pure_geom_auction<0>(set_A, set_B, params, prices);
+    }
+}
+
+// Partial matching between point clouds of any sizes, where each unmatched
+// point costs deletion_cost^wasserstein_power: the bidders are set_A followed
+// by one virtual point per point of set_B, the items set_B followed by one
+// virtual point per point of set_A (see k_virtual_point_id). Deleted points
+// are left out of the matching.
+inline AuctionResult<double> partial_wasserstein_cost_detailed(const DynamicPointVector<double>& set_A, const DynamicPointVector<double>& set_B, const AuctionParams<double>& params, const std::vector<double>& prices)
+{
+    using Real = double;
+
+    const size_t size_A = set_A.size(), size_B = set_B.size();
+    if (size_A == 0 or size_B == 0) {
+        AuctionResult<Real> result;
+        result.cost = (size_A + size_B) * std::pow(params.deletion_cost, params.wasserstein_power);
+        result.distance = std::pow(result.cost, Real(1) / params.wasserstein_power);
+        return result;
+    }
 
+    DynamicPointVector<Real> bidders(params.dim), items(params.dim);
+    bidders.resize(size_A + size_B);
+    items.resize(size_A + size_B);
+    for(unsigned a = 0; a < params.dim; ++a) {
+        std::copy(set_A.axis(a), set_A.axis(a) + size_A, bidders.axis(a));
+        std::copy(set_B.axis(a), set_B.axis(a) + size_B, items.axis(a));
+    }
+    for(size_t i = size_A; i < bidders.size(); ++i)
+        bidders.id(i) = k_virtual_point_id;
+    for(size_t i = size_B; i < items.size(); ++i)
+        items.id(i) = k_virtual_point_id;
 
+    return run_pure_geom_auction(bidders, items, params, prices);
+}
 
 inline AuctionResult<double> wasserstein_cost_detailed(const DynamicPointVector<double>& set_A, const DynamicPointVector<double>& set_B, const AuctionParams<double>& params, const std::vector<double>& prices=std::vector<double>())
 {
@@ -51,13 +117,23 @@ inline AuctionResult<double> wasserstein_cost_detailed(const DynamicPointVector<
         throw std::runtime_error("Bad epsilon factor in Wasserstein " + std::to_string(params.epsilon_common_ratio));
     }
 
-    if (set_A.size() != set_B.size()) {
+    if (set_A.size() != set_B.size() and params.deletion_cost < 0.0) {
         throw std::runtime_error("Different cardinalities of point clouds: " + std::to_string(set_A.size()) + " != " +  std::to_string(set_B.size()));
     }
 
-    DynamicTraits<Real> traits(params.dim);
+    if (set_A.dimension() != set_B.dimension()) {
+        throw std::runtime_error("Different dimensions of point clouds: " + std::to_string(set_A.dimension()) + " != " +  std::to_string(set_B.dimension()));
+    }
+
+    // the dimension is the one of the point clouds
+    AuctionParams<Real> cloud_params(params);
+    cloud_params.dim = set_A.dimension();
 
-    if (params.dim == 1) {
+    if (cloud_params.deletion_cost >= 0.0) {
+        return partial_wasserstein_cost_detailed(set_A, set_B, cloud_params, prices);
+    }
+
+    if (cloud_params.dim == 1) {
         AuctionResult<Real> result;
 
         std::vector<std::pair<Real, size_t>> set_A_copy, set_B_copy;
@@ -96,19 +172,11 @@ inline AuctionResult<double> wasserstein_cost_detailed(const DynamicPointVector<
 
         // set point id to the index in vector
         for(size_t i = 0; i < set_A_copy.size(); ++i) {
-            traits.id(set_A_copy[i]) = i;
-            traits.id(set_B_copy[i]) = i;
+            set_A_copy.id(i) = i;
+            set_B_copy.id(i) = i;
         }
 
-        if (params.max_bids_per_round == 1) {
-            hera::ws::AuctionRunnerGSR<Real> auction(set_A_copy, set_B_copy, params, prices);
-            auction.run_auction();
-            return auction.get_result();
-        } else {
-            hera::ws::AuctionRunnerJacR<Real> auction(set_A_copy, set_B_copy, params, prices);
-            auction.run_auction();
-            return auction.get_result();
-        }
+        return run_pure_geom_auction(set_A_copy, set_B_copy, cloud_params, prices);
     }
 
 
@@ -0,0 +1,13 @@
+#include <cpp11.hpp>
+
+#include "hera/dnn/parallel/tbb.h"
+
+// Number of OpenMP threads that build the kd-trees of large diagrams, see
+// hera::dnn::run_tasks; returns the previous number.
+[[cpp11::register]]
+int setKdTreeThreads(const int threads = 1)
+{
+  const int previous = hera::dnn::task_threads();
+  hera::dnn::set_task_threads(threads);
+  return previous;
+}
@@ -0,0 +1,512 @@
+#include "sinkhorn.h"
+#include "diagram_parser.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <limits>
+#include <string>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace
+{
+
+// Number of pairs solved together. The batch is stored lane-interleaved,
+// entry (i, j) of all pairs next to each other, so that the kernel-matrix
+// products are unit-stride loops of fixed length over the lanes.
+constexpr int kLanes = 8;
+
+// Scalings are absorbed into the dual potentials once they leave this range.
+constexpr double kAbsorbAbove = 1e100;
+constexpr double kAbsorbBelow = 1e-100;
+
+constexpr double kEpsilonRatio = 0.5;
+constexpr int kCheckEvery = 10;
+
+// Exact cost of the points with infinite coordinates; infinite if the
+// numbers of essential classes differ.
+double essentialCost(const hera::ws::PreparedDiagram<double>& A,
+                     const hera::ws::PreparedDiagram<double>& B,
+                     const SinkhornParams& params)
+{
+  hera::AuctionResult<double> result;
+  if (A.n_plus_inf_minus_inf != B.n_plus_inf_minus_inf ||
+      A.n_minus_inf_plus_inf != B.n_minus_inf_plus_inf)
+    return std::numeric_limits<double>::infinity();
+
+  hera::AuctionParams<double> auction_params;
+  auction_params.wasserstein_power = params.wasserstein_power;
+  hera::ws::get_one_dimensional_cost(A.x_plus, B.x_plus, auction_params, result);
+  hera::ws::get_one_dimensional_cost(A.x_minus, B.x_minus, auction_params, result);
+  hera::ws::get_one_dimensional_cost(A.y_plus, B.y_plus, auction_params, result);
+  hera::ws::get_one_dimensional_cost(A.y_minus, B.y_minus, auction_params, result);
+  return result.cost;
+}
+
+// Scratch space of one batch, reused across the batches of a thread. The
+// augmented problems are padded to a common shape: the diagonal is the last
+// row and the last column, padding rows and columns have zero mass.
+class SinkhornBatch
+{
+public:
+  // Solves the pairs (A[l], B[l]), l < num_pairs <= kLanes, all with
+  // finite points on both sides; writes the transport costs to result.
+  void solve(const SinkhornDiagram* const* A,
+             const SinkhornDiagram* const* B,
+             int num_pairs,
+             const SinkhornParams& params,
+             double* result);
+
+private:
+  double& at(std::vector<double>& matrix, size_t i, size_t j, int l)
+  {
+    return matrix[(i * cols_ + j) * kLanes + l];
+  }
+
+  void setup(const SinkhornDiagram* const* A,
+             const SinkhornDiagram* const* B,
+             int num_pairs,
+             const SinkhornParams& params);
+  void absorb();
+  void updateKernel();
+  void updateU();
+  void updateV();
+  bool converged(double tolerance);
+  void transportCost(double* result);
+
+  size_t rows_ {0}, cols_ {0};
+  std::vector<double> cost_, kernel_;
+  std::vector<double> a_, u_, f_, kv_;
+  std::vector<double> b_, v_, g_, ktu_;
+  double total_mass_[kLanes];
+  double epsilon_[kLanes];
+  // largest cost and target epsilon of each lane
+  double max_cost_[kLanes];
+  double min_epsilon_[kLanes];
+};
+
+void SinkhornBatch::setup(const SinkhornDiagram* const* A,
+                          const SinkhornDiagram* const* B,
+                          int num_pairs,
+                          const SinkhornParams& params)
+{
+  // unused lanes repeat the first pair
+  auto pair_A = [&](int l) { return A[l < num_pairs ? l : 0]; };
+  auto pair_B = [&](int l) { return B[l < num_pairs ? l : 0]; };
+
+  rows_ = cols_ = 0;
+  for (int l = 0;l < num_pairs;++l)
+  {
+    rows_ = std::max(rows_, A[l]->diagonal_costs.size() + 1);
+    cols_ = std::max(cols_, B[l]->diagonal_costs.size() + 1);
+  }
+
+  cost_.assign(rows_ * cols_ * kLanes, 0.0);
+  kernel_.resize(rows_ * cols_ * kLanes);
+  a_.assign(rows_ * kLanes, 0.0);
+  u_.assign(rows_ * kLanes, 1.0);
+  f_.assign(rows_ * kLanes, 0.0);
+  kv_.resize(rows_ * kLanes);
+  b_.assign(cols_ * kLanes, 0.0);
+  v_.assign(cols_ * kLanes, 1.0);
+  g_.assign(cols_ * kLanes, 0.0);
+  ktu_.resize(cols_ * kLanes);
+
+  const double p = params.wasserstein_power;
+  for (int l = 0;l < kLanes;++l)
+  {
+    const auto& points_A = pair_A(l)->prepared.finite_points;
+    const auto& points_B = pair_B(l)->prepared.finite_points;
+    const auto& diagonal_A = pair_A(l)->diagonal_costs;
+    const auto& diagonal_B = pair_B(l)->diagonal_costs;
+    const size_t n = points_A.size(), m = points_B.size();
+
+    double max_cost = 0.0, diagonal_cost = 0.0;
+    for (size_t i = 0;i < n;++i)
+    {
+      for (size_t j = 0;j < m;++j)
+      {
+        const double c = std::pow(hera::dist_lp(points_A[i], points_B[j], params.internal_p, 2), p);
+        at(cost_, i, j, l) = c;
+        max_cost = std::max(max_cost, c);
+      }
+      at(cost_, i, cols_ - 1, l) = diagonal_A[i];
+      max_cost = std::max(max_cost, diagonal_A[i]);
+      diagonal_cost += diagonal_A[i];
+    }
+    for (size_t j = 0;j < m;++j)
+    {
+      at(cost_, rows_ - 1, j, l) = diagonal_B[j];
+      max_cost = std::max(max_cost, diagonal_B[j]);
+      diagonal_cost += diagonal_B[j];
+    }
+
+    // masses are normalized to a total of 1
+    const double total = n + m;
+    for (size_t i = 0;i < n;++i)
+      a_[i * kLanes + l] = 1.0 / total;
+    a_[(rows_ - 1) * kLanes + l] = m / total;
+    for (size_t j = 0;j < m;++j)
+      b_[j * kLanes + l] = 1.0 / total;
+    b_[(cols_ - 1) * kLanes + l] = n / total;
+
+    // epsilon is relative to the cost per unit mass of matching everything
+    // to the diagonal, an upper bound of the optimal one
+    total_mass_[l] = total;
+    max_cost_[l] = max_cost;
+    min_epsilon_[l] = params.epsilon * diagonal_cost / total;
+  }
+}
+
+// Moves the scalings into the potentials: f += eps log u, g += eps log v.
+// Rows and columns without mass keep zero potentials.
+void SinkhornBatch::absorb()
+{
+  for (size_t i = 0;i < rows_;++i)
+  {
+    for (int l = 0;l < kLanes;++l)
+    {
+      const size_t k = i * kLanes + l;
+      if (a_[k] > 0.0)
+        f_[k] += epsilon_[l] * std::log(u_[k]);
+      u_[k] = 1.0;
+    }
+  }
+  for (size_t j = 0;j < cols_;++j)
+  {
+    for (int l = 0;l < kLanes;++l)
+    {
+      const size_t k = j * kLanes + l;
+      if (b_[k] > 0.0)
+        g_[k] += epsilon_[l] * std::log(v_[k]);
+      v_[k] = 1.0;
+    }
+  }
+}
+
+// K_ij = exp((f_i + g_j - C_ij) / eps), and 0 on padding rows and columns,
+// whose potentials are not kept bounded
+void SinkhornBatch::updateKernel()
+{
+  for (size_t i = 0;i < rows_;++i)
+  {
+    for (size_t j = 0;j < cols_;++j)
+    {
+      const size_t k = (i * cols_ + j) * kLanes;
+      for (int l = 0;l < kLanes;++l)
+      {
+        const bool padding = a_[i * kLanes + l] == 0.0 || b_[j * kLanes + l] == 0.0;
+        kernel_[k + l] = padding ? 0.0 :
+          std::exp((f_[i * kLanes + l] + g_[j * kLanes + l] - cost_[k + l]) / epsilon_[l]);
+      }
+    }
+  }
+}
+
+// u = a / (K v)
+void SinkhornBatch::updateU()
+{
+  const double* K = kernel_.data();
+  const double* v = v_.data();
+  for (size_t i = 0;i < rows_;++i)
+  {
+    double acc[kLanes] = {0.0};
+    for (size_t j = 0;j < cols_;++j)
+    {
+      const double* Kij = K + (i * cols_ + j) * kLanes;
+      const double* vj = v + j * kLanes;
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+      for (int l = 0;l < kLanes;++l)
+        acc[l] += Kij[l] * vj[l];
+    }
+    double* kv = kv_.data() + i * kLanes;
+    double* u = u_.data() + i * kLanes;
+    const double* a = a_.data() + i * kLanes;
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+    for (int l = 0;l < kLanes;++l)
+    {
+      kv[l] = acc[l];
+      u[l] = a[l] / std::max(acc[l], DBL_MIN);
+    }
+  }
+}
+
+// v = b / (K^T u)
+void SinkhornBatch::updateV()
+{
+  const double* K = kernel_.data();
+  const double* u = u_.data();
+  double* ktu = ktu_.data();
+  std::fill(ktu_.begin(), ktu_.end(), 0.0);
+  for (size_t i = 0;i < rows_;++i)
+  {
+    const double* ui = u + i * kLanes;
+    for (size_t j = 0;j < cols_;++j)
+    {
+      const double* Kij = K + (i * cols_ + j) * kLanes;
+      double* ktuj = ktu + j * kLanes;
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+      for (int l = 0;l < kLanes;++l)
+        ktuj[l] += Kij[l] * ui[l];
+    }
+  }
+  const size_t n = cols_ * kLanes;
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+  for (size_t k = 0;k < n;++k)
+    v_[k] = b_[k] / std::max(ktu[k], DBL_MIN);
+}
+
+// After a v-update the column marginals are exact; checks the rows of all
+// lanes. Recomputes K v, so u can be updated from it.
+bool SinkhornBatch::converged(double tolerance)
+{
+  double error[kLanes] = {0.0};
+  const double* K = kernel_.data();
+  for (size_t i = 0;i < rows_;++i)
+  {
+    double acc[kLanes] = {0.0};
+    for (size_t j = 0;j < cols_;++j)
+    {
+      const double* Kij = K + (i * cols_ + j) * kLanes;
+      const double* vj = v_.data() + j * kLanes;
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+      for (int l = 0;l < kLanes;++l)
+        acc[l] += Kij[l] * vj[l];
+    }
+    for (int l = 0;l < kLanes;++l)
+      error[l] += std::fabs(u_[i * kLanes + l] * acc[l] - a_[i * kLanes + l]);
+  }
+  for (int l = 0;l < kLanes;++l)
+  {
+    if (!(error[l] <= tolerance))
+      return false;
+  }
+  return true;
+}
+
+void SinkhornBatch::transportCost(double* result)
+{
+  double cost[kLanes] = {0.0};
+  for (size_t i = 0;i < rows_;++i)
+  {
+    for (size_t j = 0;j < cols_;++j)
+    {
+      const size_t k = (i * cols_ + j) * kLanes;
+      for (int l = 0;l < kLanes;++l)
+        cost[l] += u_[i * kLanes + l] * kernel_[k + l] * v_[j * kLanes + l] * cost_[k + l];
+    }
+  }
+  for (int l = 0;l < kLanes;++l)
+    result[l] = cost[l] * total_mass_[l];
+}
+
+void SinkhornBatch::solve(const SinkhornDiagram* const* A,
+                          const SinkhornDiagram* const* B,
+                          int num_pairs,
+                          const SinkhornParams& params,
+                          double* result)
+{
+  setup(A, B, num_pairs, params);
+
+  // epsilon-scaling from the largest cost down to the target of each lane;
+  // lanes that reach their target early keep iterating at it
+  double ratio = 1.0;
+  bool last_phase = false;
+  while (!last_phase)
+  {
+    // the scalings belong to the previous epsilon
+    absorb();
+
+    ratio *= kEpsilonRatio;
+    last_phase = true;
+    for (int l = 0;l < kLanes;++l)
+    {
+      epsilon_[l] = std::max(ratio * max_cost_[l], min_epsilon_[l]);
+      last_phase &= epsilon_[l] == min_epsilon_[l];
+    }
+    updateKernel();
+
+    for (int iter = 1;iter <= params.max_iter;++iter)
+    {
+      updateU();
+      updateV();
+
+      bool out_of_range = false;
+      for (double x : u_)
+        out_of_range |= x > kAbsorbAbove || (x > 0.0 && x < kAbsorbBelow);
+      for (double x : v_)
+        out_of_range |= x > kAbsorbAbove || (x > 0.0 && x < kAbsorbBelow);
+      if (out_of_range)
+      {
+        absorb();
+        updateKernel();
+      }
+
+      if (iter % kCheckEvery == 0 && converged(params.tolerance))
+        break;
+    }
+  }
+
+  double costs[kLanes];
+  transportCost(costs);
+  for (int l = 0;l < num_pairs;++l)
+    result[l] = costs[l];
+}
+
+}
+
+SinkhornDiagram sinkhornDiagram(const std::vector<std::pair<double,double>>& diagram,
+                                const SinkhornParams& params)
+{
+  SinkhornDiagram result;
+  hera::ws::prepare_diagram(diagram, result.prepared);
+  result.diagonal_costs.reserve(result.prepared.finite_points.size());
+  for (const auto& point : result.prepared.finite_points)
+    result.diagonal_costs.push_back(std::pow(point.persistence_lp(params.internal_p), params.wasserstein_power));
+  return result;
+}
+
+std::vector<double> sinkhornCosts(const std::vector<SinkhornDiagram>& diagrams,
+                                  const std::vector<std::pair<int,int>>& pairs,
+                                  const SinkhornParams& params,
+                                  unsigned int ncores)
+{
+  std::vector<double> costs(pairs.size(), 0.0);
+
+  // Pairs with an empty side are matched to the diagonal in closed form; the
+  // others are oriented with the larger diagram first and sorted by shape,
+  // so that consecutive pairs pad to nearly the same batch.
+  std::vector<size_t> batched;
+  for (size_t k = 0;k < pairs.size();++k)
+  {
+    const SinkhornDiagram& A = diagrams[pairs[k].first];
+    const SinkhornDiagram& B = diagrams[pairs[k].second];
+    costs[k] = essentialCost(A.prepared, B.prepared, params);
+    if (std::isinf(costs[k]))
+      continue;
+    if (A.diagonal_costs.empty() || B.diagonal_costs.empty())
+    {
+      for (double c : A.diagonal_costs)
+        costs[k] += c;
+      for (double c : B.diagonal_costs)
+        costs[k] += c;
+      continue;
+    }
+    batched.push_back(k);
+  }
+
+  auto shape = [&](size_t k) {
+    size_t n = diagrams[pairs[k].first].diagonal_costs.size();
+    size_t m = diagrams[pairs[k].second].diagonal_costs.size();
+    return std::make_pair(std::max(n, m), std::min(n, m));
+  };
+  std::sort(batched.begin(), batched.end(),
+            [&](size_t k1, size_t k2) { return shape(k1) < shape(k2); });
+
+  const int num_batches = (batched.size() + kLanes - 1) / kLanes;
+  std::vector<double> batch_costs(num_batches * kLanes);
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(ncores)
+#endif
+  {
+    SinkhornBatch batch;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+    for (int t = 0;t < num_batches;++t)
+    {
+      const SinkhornDiagram* A[kLanes];
+      const SinkhornDiagram* B[kLanes];
+      int num_pairs = 0;
+      for (size_t s = t * kLanes;s < batched.size() && num_pairs < kLanes;++s)
+      {
+        const SinkhornDiagram* first = &diagrams[pairs[batched[s]].first];
+        const SinkhornDiagram* second = &diagrams[pairs[batched[s]].second];
+        if (first->diagonal_costs.size() < second->diagonal_costs.size())
+          std::swap(first, second);
+        A[num_pairs] = first;
+        B[num_pairs] = second;
+        ++num_pairs;
+      }
+      batch.solve(A, B, num_pairs, params, batch_costs.data() + t * kLanes);
+    }
+  }
+
+  for (size_t s = 0;s < batched.size();++s)
+    costs[batched[s]] += batch_costs[s];
+
+  return costs;
+}
+
+void checkSinkhornParams(const SinkhornParams& params)
+{
+  if (params.wasserstein_power < 1.0)
+  {
+    std::string msg = "Wasserstein_degree was \"" +
+      std::to_string(params.wasserstein_power) +
+      "\", must be a number >= 1.0. Cannot proceed.";
+    cpp11::stop(msg.c_str());
+  }
+
+  if (params.epsilon <= 0.0)
+  {
+    std::string msg = "regularization was \"" +
+      std::to_string(params.epsilon) +
+      "\", must be a number > 0.0. Cannot proceed.";
+    cpp11::stop(msg.c_str());
+  }
+}
+
+[[cpp11::register]]
+cpp11::doubles sinkhornPairwiseDistances(const cpp11::list& x,
+                                         const double wasserstein_power = 1.0,
+                                         const double epsilon = 0.05,
+                                         const double tolerance = 1e-3,
+                                         const int max_iter = 1000,
+                                         const unsigned int ncores = 1)
+{
+  SinkhornParams params;
+  params.wasserstein_power = wasserstein_power;
+  params.epsilon = epsilon;
+  params.tolerance = tolerance;
+  params.max_iter = max_iter;
+  checkSinkhornParams(params);
+
+  unsigned int N = x.size();
+  std::vector<SinkhornDiagram> diagrams;
+  diagrams.reserve(N);
+  for (int n = 0;n < N;++n)
+  {
+    PairVector diagram;
+    parseMatrix(cpp11::as_cpp<cpp11::doubles_matrix<>>(x[n]), diagram);
+    diagrams.push_back(sinkhornDiagram(diagram, params));
+  }
+
+  // same order as the lower triangle of a dist object
+  std::vector<std::pair<int,int>> pairs;
+  pairs.reserve(N * (N - 1) / 2);
+  for (unsigned int i = 0;i + 1 < N;++i)
+    for (unsigned int j = i + 1;j < N;++j)
+      pairs.emplace_back(i, j);
+
+  std::vector<double> costs = sinkhornCosts(diagrams, pairs, params, ncores);
+
+  cpp11::writable::doubles result(costs.size());
+  for (size_t k = 0;k < costs.size();++k)
+    result[k] = std::pow(costs[k], 1.0 / wasserstein_power);
+  return result;
+}
@@ -0,0 +1,46 @@
+#ifndef PHUTIL_SINKHORN_H
+#define PHUTIL_SINKHORN_H
+
+#include "hera/wasserstein.h"
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Entropic approximation of the Wasserstein distance between persistence
+// diagrams (Lacombe, Cuturi and Oudot, 2018). The n points of A and the
+// m points of B are augmented with one diagonal point each, of mass m and n,
+// and the transport problem between the augmented diagrams is solved with
+// log-stabilized Sinkhorn iterations, epsilon-scaling from the largest cost
+// down to epsilon times the cost per unit mass of matching every point to the
+// diagonal. The returned cost is the transport cost of the entropic plan,
+// which exceeds the exact cost by a bias that vanishes as epsilon goes to 0.
+// Points with infinite coordinates are matched exactly, as in the auction.
+struct SinkhornParams
+{
+  double wasserstein_power {1.0};
+  double internal_p {hera::get_infinity<double>()};
+  double epsilon {0.05};     // relative to the cost of matching everything to the diagonal
+  double tolerance {1e-3};   // L1 violation of the marginals, relative to the total mass
+  int max_iter {1000};       // Sinkhorn iterations per epsilon
+};
+
+// A diagram prepared once for all the pairs it is part of.
+struct SinkhornDiagram
+{
+  hera::ws::PreparedDiagram<double> prepared;
+  // cost of matching each finite point to the diagonal
+  std::vector<double> diagonal_costs;
+};
+
+SinkhornDiagram sinkhornDiagram(const std::vector<std::pair<double,double>>& diagram,
+                                const SinkhornParams& params);
+
+// Transport costs (not distances) of the given pairs. Pairs of similar sizes
+// are solved together in batches, in parallel over ncores threads.
+std::vector<double> sinkhornCosts(const std::vector<SinkhornDiagram>& diagrams,
+                                  const std::vector<std::pair<int,int>>& pairs,
+                                  const SinkhornParams& params,
+                                  unsigned int ncores = 1);
+
+#endif // PHUTIL_SINKHORN_H
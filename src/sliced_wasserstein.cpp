@@ -0,0 +1,209 @@
+#include "sliced_wasserstein.h"
+#include "diagram_parser.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace
+{
+
+const double pi = 3.14159265358979323846;
+
+double directionAngle(unsigned int k, unsigned int num_directions)
+{
+  return -pi / 2.0 + (k + 0.5) * pi / num_directions;
+}
+
+// Writes the diagonal projections of a diagram onto direction k, sorted.
+void diagonalProjections(const std::vector<double>& midpoints,
+                         double scale,
+                         std::vector<double>& result)
+{
+  const size_t n = midpoints.size();
+  result.resize(n);
+  if (scale >= 0.0)
+  {
+    for (size_t i = 0;i < n;++i)
+      result[i] = scale * midpoints[i];
+  }
+  else
+  {
+    for (size_t i = 0;i < n;++i)
+      result[i] = scale * midpoints[n - 1 - i];
+  }
+}
+
+// Merges two sorted arrays; the comparison selects the element instead of a
+// branch, which is about 1.5 times faster than std::merge here.
+void mergeSorted(const double* a, size_t na,
+                 const double* b, size_t nb,
+                 double* result)
+{
+  size_t i = 0, j = 0, k = 0;
+  while (i < na && j < nb)
+  {
+    const bool take_a = a[i] <= b[j];
+    result[k++] = take_a ? a[i] : b[j];
+    i += take_a;
+    j += !take_a;
+  }
+  while (i < na)
+    result[k++] = a[i++];
+  while (j < nb)
+    result[k++] = b[j++];
+}
+
+}
+
+SlicedDiagram::SlicedDiagram(const std::vector<std::pair<double,double>>& diagram,
+                             unsigned int num_directions) :
+  num_directions_(num_directions)
+{
+  std::vector<std::pair<double,double>> points;
+  points.reserve(diagram.size());
+  for (const auto& point : diagram)
+  {
+    if (point.first != point.second &&
+        std::isfinite(point.first) && std::isfinite(point.second))
+      points.push_back(point);
+  }
+
+  const size_t n = points.size();
+  midpoints_.reserve(n);
+  for (const auto& point : points)
+    midpoints_.push_back((point.first + point.second) / 2.0);
+  std::sort(midpoints_.begin(), midpoints_.end());
+
+  projections_.resize(n * num_directions);
+  for (unsigned int k = 0;k < num_directions;++k)
+  {
+    const double theta = directionAngle(k, num_directions);
+    const double c = std::cos(theta), s = std::sin(theta);
+    double* block = projections_.data() + k * n;
+    for (size_t i = 0;i < n;++i)
+      block[i] = c * points[i].first + s * points[i].second;
+    std::sort(block, block + n);
+  }
+}
+
+double slicedWassersteinDistance(const SlicedDiagram& a,
+                                 const SlicedDiagram& b,
+                                 SlicedWassersteinBuffer& buffer)
+{
+  const unsigned int M = a.num_directions();
+  const size_t n = a.size() + b.size();
+  if (n == 0 || M == 0)
+    return 0.0;
+
+  buffer.first.resize(n);
+  buffer.second.resize(n);
+  double total = 0.0;
+  for (unsigned int k = 0;k < M;++k)
+  {
+    const double theta = directionAngle(k, M);
+    const double scale = std::cos(theta) + std::sin(theta);
+
+    // A u Delta(B)
+    diagonalProjections(b.midpoints(), scale, buffer.diagonal);
+    mergeSorted(a.projections(k), a.size(),
+                buffer.diagonal.data(), buffer.diagonal.size(),
+                buffer.first.data());
+    // B u Delta(A)
+    diagonalProjections(a.midpoints(), scale, buffer.diagonal);
+    mergeSorted(b.projections(k), b.size(),
+                buffer.diagonal.data(), buffer.diagonal.size(),
+                buffer.second.data());
+
+    const double* u = buffer.first.data();
+    const double* v = buffer.second.data();
+    double sum = 0.0;
+#ifdef _OPENMP
+#pragma omp simd reduction(+:sum)
+#endif
+    for (size_t i = 0;i < n;++i)
+      sum += std::fabs(u[i] - v[i]);
+    total += sum;
+  }
+
+  return total / M;
+}
+
+std::vector<SlicedDiagram> slicedDiagrams(const cpp11::list& x,
+                                          unsigned int num_directions)
+{
+  std::vector<SlicedDiagram> result;
+  result.reserve(x.size());
+  for (int n = 0;n < x.size();++n)
+  {
+    PairVector diagram;
+    parseMatrix(cpp11::as_cpp<cpp11::doubles_matrix<>>(x[n]), diagram);
+    result.emplace_back(diagram, num_directions);
+  }
+  return result;
+}
+
+[[cpp11::register]]
+cpp11::doubles slicedWassersteinPairwiseDistances(const cpp11::list& x,
+                                                  const int num_directions = 50,
+                                                  const unsigned int ncores = 1)
+{
+  unsigned int N = x.size();
+  unsigned int K = N * (N - 1) / 2;
+  std::vector<double> distances(K);
+  std::vector<SlicedDiagram> diagrams = slicedDiagrams(x, num_directions);
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(ncores)
+#endif
+  {
+    SlicedWassersteinBuffer buffer;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 64)
+#endif
+    for (int k = 0;k < K;++k)
+    {
+      unsigned int i = N - 2 - std::floor(std::sqrt(-8 * k + 4 * N * (N - 1) - 7) / 2.0 - 0.5);
+      unsigned int j = k + i + 1 - N * (N - 1) / 2 + (N - i) * ((N - i) - 1) / 2;
+      distances[k] = slicedWassersteinDistance(diagrams[i], diagrams[j], buffer);
+    }
+  }
+
+  return cpp11::writable::doubles(distances.begin(), distances.end());
+}
+
+[[cpp11::register]]
+cpp11::doubles_matrix<> slicedWassersteinCrossDistances(const cpp11::list& x,
+                                                        const cpp11::list& y,
+                                                        const int num_directions = 50,
+                                                        const unsigned int ncores = 1)
+{
+  int N = x.size(), M = y.size();
+  std::vector<double> distances(N * M);
+  std::vector<SlicedDiagram> diagramsX = slicedDiagrams(x, num_directions);
+  std::vector<SlicedDiagram> diagramsY = slicedDiagrams(y, num_directions);
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(ncores)
+#endif
+  {
+    SlicedWassersteinBuffer buffer;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 64)
+#endif
+    for (int k = 0;k < N * M;++k)
+    {
+      distances[k] = slicedWassersteinDistance(diagramsX[k % N], diagramsY[k / N], buffer);
+    }
+  }
+
+  // column-major, as k = i + N * j
+  cpp11::writable::doubles_matrix<> result(N, M);
+  for (int j = 0;j < M;++j)
+    for (int i = 0;i < N;++i)
+      result(i, j) = distances[i + N * j];
+  return result;
+}
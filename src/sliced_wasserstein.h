@@ -0,0 +1,51 @@
+#ifndef PHUTIL_SLICED_WASSERSTEIN_H
+#define PHUTIL_SLICED_WASSERSTEIN_H
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// A persistence diagram prepared for sliced Wasserstein distances (Carriere,
+// Cuturi and Oudot, 2017). For each of the M directions
+// theta_k = -pi/2 + (k + 1/2) pi / M, the projections <x, theta_k> of the
+// finite off-diagonal points are stored sorted, in one contiguous block per
+// direction. The diagonal projections of the points all lie on the line
+// y = x, so their projections are (b + d) / 2 * (cos theta_k + sin theta_k)
+// and one sorted vector of midpoints serves every direction.
+// Points at infinity are ignored.
+class SlicedDiagram
+{
+public:
+  SlicedDiagram() = default;
+  SlicedDiagram(const std::vector<std::pair<double,double>>& diagram,
+                unsigned int num_directions);
+
+  size_t size() const { return midpoints_.size(); }
+  unsigned int num_directions() const { return num_directions_; }
+
+  // sorted projections of the points onto direction k
+  const double* projections(unsigned int k) const { return projections_.data() + k * size(); }
+  // sorted (b + d) / 2 of the points
+  const std::vector<double>& midpoints() const { return midpoints_; }
+
+private:
+  unsigned int num_directions_ {0};
+  std::vector<double> projections_;
+  std::vector<double> midpoints_;
+};
+
+// Scratch space of slicedWassersteinDistance, one per thread.
+struct SlicedWassersteinBuffer
+{
+  std::vector<double> first, second, diagonal;
+};
+
+// Sliced Wasserstein distance
+//   SW(A, B) = 1 / pi * int_{-pi/2}^{pi/2} W_1(pi_theta(A u Delta(B)), pi_theta(B u Delta(A))) dtheta
+// by the midpoint rule over the directions of the diagrams, which must agree.
+// Each W_1 is the L1 distance between the two merged sorted arrays.
+double slicedWassersteinDistance(const SlicedDiagram& a,
+                                 const SlicedDiagram& b,
+                                 SlicedWassersteinBuffer& buffer);
+
+#endif // PHUTIL_SLICED_WASSERSTEIN_H
@@ -0,0 +1,71 @@
+#include "synthetic_diagrams.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+
+// The splitmix64 generator of Steele, Lea and Flood (2014): one state word
+// and a few multiplications per draw, several times faster than
+// std::mt19937_64, which dominated the time to generate large diagrams.
+struct SplitMix64
+{
+  std::uint64_t state;
+
+  std::uint64_t operator()()
+  {
+    std::uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+};
+
+// uniform in [0, 1), from the 53 high bits of the generator
+double uniform(SplitMix64& gen)
+{
+  return (gen() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+}
+
+std::vector<std::pair<double,double>> syntheticDiagram(const std::size_t n,
+                                                       const SyntheticDiagramParams& params,
+                                                       const std::uint64_t seed)
+{
+  SplitMix64 gen { seed };
+  std::vector<std::pair<double,double>> result;
+  result.reserve(n);
+
+  const std::size_t num_features = std::min(params.num_features, n);
+  for (std::size_t i = 0;i < num_features;++i)
+  {
+    double birth = params.max_birth / 2.0 * uniform(gen);
+    double persistence = params.feature_persistence * (1.0 + uniform(gen)) / 2.0;
+    result.emplace_back(birth, birth + persistence);
+  }
+
+  const std::size_t num_essential = std::min(params.num_essential, n - result.size());
+  for (std::size_t i = 0;i < num_essential;++i)
+    result.emplace_back(params.max_birth / 2.0 * uniform(gen),
+                        std::numeric_limits<double>::infinity());
+
+  // noise, by inversion of the exponential distribution
+  const std::size_t first_noise = result.size();
+  while (result.size() < n)
+  {
+    std::size_t num_noise = result.size() - first_noise;
+    if (num_noise > 0 && uniform(gen) < params.duplicate_rate)
+    {
+      result.push_back(result[first_noise + static_cast<std::size_t>(uniform(gen) * num_noise)]);
+      continue;
+    }
+    double birth = params.max_birth * uniform(gen);
+    double persistence = -params.noise_persistence * std::log1p(-uniform(gen));
+    result.emplace_back(birth, birth + persistence);
+  }
+
+  return result;
+}
@@ -0,0 +1,36 @@
+#ifndef PHUTIL_SYNTHETIC_DIAGRAMS_H
+#define PHUTIL_SYNTHETIC_DIAGRAMS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Shape of a synthetic persistence diagram, loosely that of the diagram of a
+// noisy sample: many short-lived points near the diagonal, a few features of
+// high persistence and some essential classes, which never die.
+//  - noise: births uniform in [0, max_birth], persistence exponential with
+//    mean noise_persistence; each noise point is, with probability
+//    duplicate_rate, a copy of an earlier noise point instead;
+//  - features: births uniform in [0, max_birth / 2], persistence uniform in
+//    [feature_persistence / 2, feature_persistence];
+//  - essential classes: births uniform in [0, max_birth / 2], death +Inf.
+struct SyntheticDiagramParams
+{
+  double max_birth {1.0};
+  double noise_persistence {0.05};
+  double duplicate_rate {0.0};
+  std::size_t num_features {10};
+  double feature_persistence {1.0};
+  std::size_t num_essential {1};
+};
+
+// A diagram of n points in total, features and essential classes first, the
+// rest being noise. The points only depend on the seed and the parameters,
+// whatever the platform: they are drawn from a splitmix64 generator without
+// the standard distributions, whose output differs between implementations.
+std::vector<std::pair<double,double>> syntheticDiagram(std::size_t n,
+                                                       const SyntheticDiagramParams& params,
+                                                       std::uint64_t seed);
+
+#endif // PHUTIL_SYNTHETIC_DIAGRAMS_H
@@ -0,0 +1,31 @@
+#include "diagram_parser.h"
+#include "synthetic_diagrams.h"
+
+// A synthetic diagram, see syntheticDiagram, as an n x 2 matrix.
+[[cpp11::register]]
+cpp11::doubles_matrix<> syntheticDiagramMatrix(const int n,
+                                               const double max_birth = 1.0,
+                                               const double noise_persistence = 0.05,
+                                               const double duplicate_rate = 0.0,
+                                               const int num_features = 10,
+                                               const double feature_persistence = 1.0,
+                                               const int num_essential = 1,
+                                               const int seed = 1)
+{
+  SyntheticDiagramParams params;
+  params.max_birth = max_birth;
+  params.noise_persistence = noise_persistence;
+  params.duplicate_rate = duplicate_rate;
+  params.num_features = num_features;
+  params.feature_persistence = feature_persistence;
+  params.num_essential = num_essential;
+
+  PairVector diagram = syntheticDiagram(n, params, seed);
+  cpp11::writable::doubles_matrix<> result(n, 2);
+  for (int i = 0;i < n;++i)
+  {
+    result(i, 0) = diagram[i].first;
+    result(i, 1) = diagram[i].second;
+  }
+  return result;
+}
@@ -0,0 +1,73 @@
+#include "warm_start.h"
+
+#include <algorithm>
+#include <cmath>
+
+void NearestPointIndex::build(const DiagramPointVector& points)
+{
+  kdtree_.reset();
+  points_.clear();
+  points_.reserve(points.size());
+  for (size_t i = 0;i < points.size();++i)
+  {
+    DnnPoint p(i);
+    p[0] = points[i].x;
+    p[1] = points[i].y;
+    points_.push_back(p);
+  }
+
+  if (points_.empty())
+    return;
+
+  std::vector<DnnPoint*> handles;
+  handles.reserve(points_.size());
+  for (auto& p : points_)
+    handles.push_back(&p);
+
+  DnnTraits traits;
+  traits.internal_p = hera::get_infinity<double>();
+  kdtree_.reset(new hera::ws::dnn::KDTree<DnnTraits>(traits, std::move(handles)));
+}
+
+std::pair<size_t, double> NearestPointIndex::nearest(double x, double y) const
+{
+  DnnPoint q;
+  q[0] = x;
+  q[1] = y;
+  auto result = kdtree_->find(q);
+  return std::make_pair(static_cast<size_t>(result.p->id()), static_cast<double>(result.d));
+}
+
+double remapPrices(const NearestPointIndex& index,
+                   const std::vector<double>& index_prices,
+                   const DiagramPointVector& points,
+                   std::vector<double>& prices)
+{
+  double shift = 0.0;
+  for (const auto& point : points)
+  {
+    if (index.empty())
+    {
+      prices.push_back(0.0);
+      continue;
+    }
+    auto nearest = index.nearest(point.x, point.y);
+    shift = std::max(shift, nearest.second);
+    prices.push_back(index_prices[nearest.first]);
+  }
+  return shift;
+}
+
+double warmStartEpsilon(double previous_epsilon,
+                        double previous_distance,
+                        double shift,
+                        double wasserstein_power)
+{
+  if (!std::isfinite(previous_epsilon))
+    previous_epsilon = 0.0;
+  if (!std::isfinite(previous_distance))
+    previous_distance = 0.0;
+  double cost_change = wasserstein_power * shift *
+    std::pow(previous_distance, wasserstein_power - 1.0);
+  return std::max(previous_epsilon, cost_change);
+}
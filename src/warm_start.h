@@ -0,0 +1,56 @@
+#ifndef PHUTIL_WARM_START_H
+#define PHUTIL_WARM_START_H
+
+#include <cmath>
+
+#include "hera/common/diagram_point.h"
+#include "hera/dnn/geometry/euclidean-fixed.h"
+#include "hera/dnn/local/kd-tree.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+using DiagramPointVector = std::vector<hera::DiagramPoint<double>>;
+
+// Nearest-neighbour lookup among the points of a persistence diagram, used to
+// carry auction prices over to the points of a similar diagram.
+class NearestPointIndex
+{
+public:
+  NearestPointIndex() = default;
+  explicit NearestPointIndex(const DiagramPointVector& points) { build(points); }
+
+  void build(const DiagramPointVector& points);
+  bool empty() const { return points_.empty(); }
+
+  // position in the indexed points and l_inf distance of the nearest point
+  std::pair<size_t, double> nearest(double x, double y) const;
+
+private:
+  using DnnPoint = hera::ws::dnn::Point<2, double>;
+  using DnnTraits = hera::ws::dnn::PointTraits<DnnPoint>;
+
+  std::vector<DnnPoint> points_;
+  std::unique_ptr<hera::ws::dnn::KDTree<DnnTraits>> kdtree_;
+};
+
+// Appends to `prices` the price of the nearest indexed point of each of
+// `points` and returns the largest distance to a nearest point. Points get a
+// zero price if the index is empty.
+double remapPrices(const NearestPointIndex& index,
+                   const std::vector<double>& index_prices,
+                   const DiagramPointVector& points,
+                   std::vector<double>& prices);
+
+// Remapped prices violate the optimality conditions of the new problem by
+// about the change in edge costs caused by the largest point displacement,
+// at most p * shift * d^(p - 1) for edges not longer than the previous
+// distance d. Epsilon scaling can start there instead of at the coarse
+// default, but not below the previous final epsilon.
+double warmStartEpsilon(double previous_epsilon,
+                        double previous_distance,
+                        double shift,
+                        double wasserstein_power);
+
+#endif // PHUTIL_WARM_START_H
@@ -1,38 +1,15 @@
 #include "hera/wasserstein.h"
 #include "diagram_parser.h"
+#include "warm_start.h"
+#include "wasserstein_multiscale.h"
+#include "wasserstein_stream.h"
 
 #include <cmath>
 #include <limits>
 #include <string>
 
-double wassersteinDist(PairVector& diagramA,
-                       PairVector& diagramB,
-                       const double wasserstein_power = 1.0,
-                       const double delta = 0.01,
-                       const double internal_p = hera::get_infinity<double>(),
-                       const double initial_epsilon = 0.0,
-                       const double epsilon_common_ratio = 5.0,
-                       const int max_bids_per_round = 1,
-                       const int max_num_phases = std::numeric_limits<int>::max(),
-                       const bool tolerate_max_iter_exceeded = false,
-                       const bool return_matching = false,
-                       const bool match_inf_points = true,
-                       const bool print_relative_tolerance = false,
-                       const bool verbose = false)
+void checkAuctionParams(const hera::AuctionParams<double>& params)
 {
-  using Real = double;
-  hera::AuctionParams<Real> params;
-  params.wasserstein_power = wasserstein_power;
-  params.delta = delta;
-  params.internal_p = internal_p;
-  params.initial_epsilon = initial_epsilon;
-  params.epsilon_common_ratio = epsilon_common_ratio;
-  params.max_bids_per_round = max_bids_per_round;
-  params.max_num_phases = max_num_phases;
-  params.tolerate_max_iter_exceeded = tolerate_max_iter_exceeded;
-  params.return_matching = return_matching;
-  params.match_inf_points = match_inf_points;
-
   if (params.wasserstein_power < 1.0)
   {
     std::string msg = "Wasserstein_degree was \"" +
@@ -41,11 +18,6 @@ double wassersteinDist(PairVector& diagramA,
     cpp11::stop(msg.c_str());
   }
 
-  if (params.wasserstein_power == 1.0)
-  {
-    hera::remove_duplicates<Real>(diagramA, diagramB);
-  }
-
   if (params.delta <= 0.0)
   {
     std::string msg = "relative error was \"" +
@@ -53,28 +25,334 @@ double wassersteinDist(PairVector& diagramA,
       "\", must be a number > 0.0. Cannot proceed.";
     cpp11::stop(msg.c_str());
   }
+}
 
-  auto res = hera::wasserstein_cost_detailed(diagramA, diagramB, params);
+// Points that become auction items: finite and off the diagonal.
+bool isAuctionPoint(const std::pair<double,double>& point)
+{
+  return point.first != point.second &&
+    std::isfinite(point.first) && std::isfinite(point.second);
+}
+
+// Auction points of a diagram, their ids are row indices.
+DiagramPointVector auctionPoints(const PairVector& diagram)
+{
+  DiagramPointVector result;
+  for (int i = 0;i < diagram.size();++i)
+  {
+    if (isAuctionPoint(diagram[i]))
+      result.emplace_back(diagram[i].first, diagram[i].second,
+                          hera::DiagramPoint<double>::NORMAL, i);
+  }
+  return result;
+}
+
+// Carries the prices of a previous auction, one per row of `reference`, over
+// to the auction points of `diagram`; returns the largest displacement.
+double remapRowPrices(const PairVector& reference,
+                      const cpp11::doubles& reference_prices,
+                      const PairVector& diagram,
+                      std::vector<double>& prices)
+{
+  DiagramPointVector priced_points;
+  std::vector<double> known_prices;
+  for (const auto& point : auctionPoints(reference))
+  {
+    if (std::isnan(reference_prices[point.id]))
+      continue;
+    priced_points.push_back(point);
+    known_prices.push_back(reference_prices[point.id]);
+  }
+
+  NearestPointIndex index(priced_points);
+  return remapPrices(index, known_prices, auctionPoints(diagram), prices);
+}
 
-  return res.distance;
+// Spreads auction prices (in item order) back over the rows of a diagram,
+// rows that are not auction points get NA.
+cpp11::writable::doubles pricesByRow(const PairVector& points,
+                                     const std::vector<double>& prices,
+                                     unsigned int offset)
+{
+  cpp11::writable::doubles result(points.size());
+  for (int i = 0;i < points.size();++i)
+  {
+    if (isAuctionPoint(points[i]) && offset < prices.size())
+      result[i] = prices[offset++];
+    else
+      result[i] = NA_REAL;
+  }
+  return result;
+}
+
+hera::AuctionResult<double> wassersteinDist(const PairVector& diagramA,
+                                            const PairVector& diagramB,
+                                            const double wasserstein_power = 1.0,
+                                            const double delta = 0.01,
+                                            const double prune_error_budget = 0.0,
+                                            const int oracle_type = 0,
+                                            const bool adaptive_epsilon = true,
+                                            const double internal_p = hera::get_infinity<double>(),
+                                            const double initial_epsilon = 0.0,
+                                            const double epsilon_common_ratio = 5.0,
+                                            const int max_bids_per_round = 1,
+                                            const int max_num_phases = std::numeric_limits<int>::max(),
+                                            const bool tolerate_max_iter_exceeded = false,
+                                            const bool return_matching = false,
+                                            const bool match_inf_points = true,
+                                            const bool print_relative_tolerance = false,
+                                            const bool verbose = false)
+{
+  using Real = double;
+  hera::AuctionParams<Real> params;
+  params.wasserstein_power = wasserstein_power;
+  params.delta = delta;
+  params.internal_p = internal_p;
+  params.initial_epsilon = initial_epsilon;
+  params.epsilon_common_ratio = epsilon_common_ratio;
+  params.adaptive_epsilon = adaptive_epsilon;
+  params.prune_error_budget = prune_error_budget;
+  params.oracle_type = static_cast<hera::AuctionOracleType>(oracle_type);
+  params.max_bids_per_round = max_bids_per_round;
+  params.max_num_phases = max_num_phases;
+  params.tolerate_max_iter_exceeded = tolerate_max_iter_exceeded;
+  params.return_matching = return_matching;
+  params.match_inf_points = match_inf_points;
+
+  params.remove_duplicates = params.wasserstein_power == 1.0;
+
+  checkAuctionParams(params);
+
+  return hera::wasserstein_cost_detailed(diagramA, diagramB, params);
 }
 
 [[cpp11::register]]
 double wassersteinDistance(const cpp11::doubles_matrix<>& x,
                            const cpp11::doubles_matrix<>& y,
                            const double delta = 0.01,
-                           const double wasserstein_power = 1.0)
+                           const double wasserstein_power = 1.0,
+                           const int oracle_type = 0,
+                           const bool adaptive_epsilon = true)
+{
+  PairVector diagramA, diagramB;
+  parseMatrix(x, diagramA);
+  parseMatrix(y, diagramB);
+  return wassersteinDist(diagramA, diagramB, wasserstein_power, delta, 0.0, oracle_type, adaptive_epsilon).distance;
+}
+
+// Coarse-to-fine auction, see multiscaleWassersteinCost; diagrams too small
+// for a coarse level are solved by the flat auction.
+[[cpp11::register]]
+double wassersteinDistanceMultiscale(const cpp11::doubles_matrix<>& x,
+                                     const cpp11::doubles_matrix<>& y,
+                                     const double delta = 0.01,
+                                     const double wasserstein_power = 1.0,
+                                     const int oracle_type = 0,
+                                     const bool adaptive_epsilon = true)
+{
+  hera::AuctionParams<double> params;
+  params.wasserstein_power = wasserstein_power;
+  params.delta = delta;
+  params.adaptive_epsilon = adaptive_epsilon;
+  params.oracle_type = static_cast<hera::AuctionOracleType>(oracle_type);
+  checkAuctionParams(params);
+
+  PairVector diagramA, diagramB;
+  parseMatrix(x, diagramA);
+  parseMatrix(y, diagramB);
+
+  hera::ws::PreparedDiagram<double> preparedA, preparedB;
+  if (hera::ws::prepare_diagrams(diagramA, diagramB, wasserstein_power == 1.0, preparedA, preparedB))
+    return 0.0;
+  return multiscaleWassersteinCost(preparedA, preparedB, params).distance;
+}
+
+[[cpp11::register]]
+cpp11::doubles wassersteinDistancePruned(const cpp11::doubles_matrix<>& x,
+                                         const cpp11::doubles_matrix<>& y,
+                                         const double prune_error_budget,
+                                         const double delta = 0.01,
+                                         const double wasserstein_power = 1.0,
+                                         const int oracle_type = 0,
+                                         const bool adaptive_epsilon = true)
+{
+  PairVector diagramA, diagramB;
+  parseMatrix(x, diagramA);
+  parseMatrix(y, diagramB);
+  auto res = wassersteinDist(diagramA, diagramB, wasserstein_power, delta, prune_error_budget, oracle_type, adaptive_epsilon);
+
+  using namespace cpp11::literals;
+  return cpp11::writable::doubles({
+    "distance"_nm = res.distance,
+    "error_bound"_nm = res.prune_error_bound,
+    "num_pruned"_nm = static_cast<double>(res.num_pruned_points)
+  });
+}
+
+// Length of a matching edge in the infinity norm, infinite coordinates
+// that agree do not count; b = nullptr stands for the diagonal.
+double matchingEdgeCost(const std::pair<double,double>& a,
+                        const std::pair<double,double>* b)
+{
+  if (b == nullptr)
+    return std::fabs(a.second - a.first) / 2.0;
+  double dx = a.first == b->first ? 0.0 : std::fabs(a.first - b->first);
+  double dy = a.second == b->second ? 0.0 : std::fabs(a.second - b->second);
+  return std::max(dx, dy);
+}
+
+// The matching as a list of edges: 1-based rows of x and y, -1 for the
+// diagonal, and the length of each edge. Rows of x come first in order,
+// followed by the rows of y that go to the diagonal.
+[[cpp11::register]]
+cpp11::list wassersteinMatching(const cpp11::doubles_matrix<>& x,
+                                const cpp11::doubles_matrix<>& y,
+                                const double delta = 0.01,
+                                const double wasserstein_power = 1.0,
+                                const int oracle_type = 0,
+                                const bool adaptive_epsilon = true)
+{
+  using namespace cpp11::literals;
+
+  PairVector diagramA, diagramB;
+  parseMatrix(x, diagramA);
+  parseMatrix(y, diagramB);
+
+  hera::AuctionParams<double> params;
+  params.wasserstein_power = wasserstein_power;
+  params.delta = delta;
+  params.adaptive_epsilon = adaptive_epsilon;
+  params.oracle_type = static_cast<hera::AuctionOracleType>(oracle_type);
+  params.return_matching = true;
+  params.remove_duplicates = params.wasserstein_power == 1.0;
+  checkAuctionParams(params);
+
+  auto res = hera::wasserstein_cost_detailed(diagramA, diagramB, params);
+  const auto& a_to_b = res.matching_a_to_b_;
+  const auto& b_to_a = res.matching_b_to_a_;
+
+  int numEdges = a_to_b.size();
+  for (int j = 0;j < b_to_a.size();++j)
+    numEdges += b_to_a[j] < 0;
+
+  cpp11::writable::integers rowsA(numEdges), rowsB(numEdges);
+  cpp11::writable::doubles costs(numEdges);
+  int k = 0;
+  for (int i = 0;i < a_to_b.size();++i, ++k)
+  {
+    int j = a_to_b[i];
+    rowsA[k] = i + 1;
+    rowsB[k] = j < 0 ? -1 : j + 1;
+    costs[k] = matchingEdgeCost(diagramA[i], j < 0 ? nullptr : &diagramB[j]);
+  }
+  for (int j = 0;j < b_to_a.size();++j)
+  {
+    if (b_to_a[j] >= 0)
+      continue;
+    rowsA[k] = -1;
+    rowsB[k] = j + 1;
+    costs[k] = matchingEdgeCost(diagramB[j], nullptr);
+    ++k;
+  }
+
+  return cpp11::writable::list({
+    "distance"_nm = res.distance,
+    "x"_nm = rowsA,
+    "y"_nm = rowsB,
+    "cost"_nm = costs
+  });
+}
+
+[[cpp11::register]]
+cpp11::list wassersteinDistanceWarmStart(const cpp11::doubles_matrix<>& x,
+                                         const cpp11::doubles_matrix<>& y,
+                                         const cpp11::list& warm_start,
+                                         const double delta = 0.01,
+                                         const double wasserstein_power = 1.0,
+                                         const bool adaptive_epsilon = true)
 {
+  using namespace cpp11::literals;
+
+  hera::AuctionParams<double> params;
+  params.wasserstein_power = wasserstein_power;
+  params.delta = delta;
+  params.adaptive_epsilon = adaptive_epsilon;
+  checkAuctionParams(params);
+
+  // Duplicates are not removed here: that would reorder the points and break
+  // the correspondence between auction items and rows.
   PairVector diagramA, diagramB;
   parseMatrix(x, diagramA);
   parseMatrix(y, diagramB);
-  return wassersteinDist(diagramA, diagramB, wasserstein_power, delta);
+
+  std::vector<double> prices;
+  if (warm_start.size() > 0)
+  {
+    PairVector previousA, previousB;
+    parseMatrix(cpp11::as_cpp<cpp11::doubles_matrix<>>(warm_start["x"]), previousA);
+    parseMatrix(cpp11::as_cpp<cpp11::doubles_matrix<>>(warm_start["y"]), previousB);
+    cpp11::list previous_prices(warm_start["prices"]);
+    double shift = std::max(
+      remapRowPrices(previousA, cpp11::doubles(previous_prices["x"]), diagramA, prices),
+      remapRowPrices(previousB, cpp11::doubles(previous_prices["y"]), diagramB, prices)
+    );
+    params.initial_epsilon = warmStartEpsilon(
+      cpp11::as_cpp<double>(warm_start["epsilon"]),
+      cpp11::as_cpp<double>(warm_start["distance"]),
+      shift,
+      params.wasserstein_power
+    );
+  }
+
+  auto res = hera::wasserstein_cost_detailed(diagramA, diagramB, params, prices);
+
+  unsigned int numItemsA = 0;
+  for (const auto& point : diagramA)
+    numItemsA += isAuctionPoint(point);
+
+  return cpp11::writable::list({
+    "distance"_nm = res.distance,
+    "prices_x"_nm = pricesByRow(diagramA, res.prices, 0),
+    "prices_y"_nm = pricesByRow(diagramB, res.prices, numItemsA),
+    "epsilon"_nm = res.final_epsilon > 0.0 ? res.final_epsilon : NA_REAL
+  });
+}
+
+[[cpp11::register]]
+cpp11::doubles wassersteinStreamDistances(const cpp11::list& x,
+                                          const double delta = 0.01,
+                                          const double wasserstein_power = 1.0,
+                                          const int lag = 1)
+{
+  hera::AuctionParams<double> params;
+  params.wasserstein_power = wasserstein_power;
+  params.delta = delta;
+  params.adaptive_epsilon = true;
+  checkAuctionParams(params);
+
+  int N = x.size();
+  cpp11::writable::doubles result(N > lag ? N - lag : 0);
+  WassersteinStream stream(params, lag);
+
+  for (int n = 0;n < N;++n)
+  {
+    PairVector diagram;
+    parseMatrix(cpp11::as_cpp<cpp11::doubles_matrix<>>(x[n]), diagram);
+    double distance = stream.push(diagram);
+    if (n >= lag)
+      result[n - lag] = distance;
+  }
+
+  return result;
 }
 
 [[cpp11::register]]
 cpp11::doubles wassersteinPairwiseDistances(const cpp11::list& x,
                                             const double delta = 0.01,
                                             const double wasserstein_power = 1.0,
+                                            const double prune_error_budget = 0.0,
+                                            const int oracle_type = 0,
+                                            const bool adaptive_epsilon = true,
                                             const unsigned int ncores = 1)
 {
   unsigned int N = x.size();
@@ -95,7 +373,7 @@ cpp11::doubles wassersteinPairwiseDistances(const cpp11::list& x,
   {
     unsigned int i = N - 2 - std::floor(std::sqrt(-8 * k + 4 * N * (N - 1) - 7) / 2.0 - 0.5);
     unsigned int j = k + i + 1 - N * (N - 1) / 2 + (N - i) * ((N - i) - 1) / 2;
-    result[k] = wassersteinDist(pairs[i], pairs[j], wasserstein_power, delta);
+    result[k] = wassersteinDist(pairs[i], pairs[j], wasserstein_power, delta, prune_error_budget, oracle_type, adaptive_epsilon).distance;
   }
 
   return result;
@@ -0,0 +1,181 @@
+#include "wasserstein_multiscale.h"
+#include "warm_start.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using PreparedDiagram = hera::ws::PreparedDiagram<double>;
+
+// Bounding box of the finite points of both diagrams.
+struct Grid
+{
+  double x0 {0.0}, y0 {0.0}, scale {0.0};
+
+  Grid(const PreparedDiagram& A, const PreparedDiagram& B)
+  {
+    double x1 = -hera::get_infinity<double>(), y1 = x1;
+    x0 = y0 = hera::get_infinity<double>();
+    for (const auto* diagram : {&A, &B})
+    {
+      for (const auto& point : diagram->finite_points)
+      {
+        x0 = std::min(x0, point.x); x1 = std::max(x1, point.x);
+        y0 = std::min(y0, point.y); y1 = std::max(y1, point.y);
+      }
+    }
+    const double side = std::max(x1 - x0, y1 - y0);
+    scale = side > 0.0 ? 65535.0 / side : 0.0;
+  }
+
+  // position on a Morton curve over a 2^16 x 2^16 grid
+  uint64_t code(double x, double y) const
+  {
+    const uint32_t i = static_cast<uint32_t>((x - x0) * scale);
+    const uint32_t j = static_cast<uint32_t>((y - y0) * scale);
+    uint64_t result = 0;
+    for (int b = 0;b < 16;++b)
+    {
+      result |= static_cast<uint64_t>((i >> b) & 1u) << (2 * b);
+      result |= static_cast<uint64_t>((j >> b) & 1u) << (2 * b + 1);
+    }
+    return result;
+  }
+};
+
+// Finite points of a diagram in Morton order.
+std::vector<size_t> mortonOrder(const PreparedDiagram& diagram, const Grid& grid)
+{
+  std::vector<std::pair<uint64_t, size_t>> keys;
+  keys.reserve(diagram.finite_points.size());
+  for (size_t i = 0;i < diagram.finite_points.size();++i)
+  {
+    const auto& point = diagram.finite_points[i];
+    keys.emplace_back(grid.code(point.x, point.y), i);
+  }
+  std::sort(keys.begin(), keys.end());
+
+  std::vector<size_t> result;
+  result.reserve(keys.size());
+  for (const auto& key : keys)
+    result.push_back(key.second);
+  return result;
+}
+
+// Every stride-th point in Morton order, starting from the middle of the
+// first stride so that both ends of the curve are represented.
+PreparedDiagram stratifiedSample(const PreparedDiagram& diagram,
+                                 const std::vector<size_t>& order,
+                                 size_t stride)
+{
+  PreparedDiagram result;
+  int id = 0;
+  for (size_t k = stride / 2;k < order.size();k += stride)
+  {
+    const auto& point = diagram.finite_points[order[k]];
+    result.add_point(point.x, point.y, id++);
+  }
+  return result;
+}
+
+// The auction cannot certify a zero cost, levels with equal finite points
+// are skipped.
+bool equalPoints(const PreparedDiagram& A, const PreparedDiagram& B)
+{
+  if (A.finite_points.size() != B.finite_points.size())
+    return false;
+  std::vector<std::pair<double,double>> a, b;
+  for (const auto& point : A.finite_points)
+    a.emplace_back(point.x, point.y);
+  for (const auto& point : B.finite_points)
+    b.emplace_back(point.x, point.y);
+  std::sort(a.begin(), a.end());
+  std::sort(b.begin(), b.end());
+  return a == b;
+}
+
+} // namespace
+
+hera::AuctionResult<double> multiscaleWassersteinCost(const PreparedDiagram& A,
+                                                      const PreparedDiagram& B,
+                                                      const hera::AuctionParams<double>& params,
+                                                      const MultiscaleParams& multiscale)
+{
+  const size_t size = std::min(A.finite_points.size(), B.finite_points.size());
+  const size_t ratio = std::max(multiscale.ratio, 2u);
+
+  // coarse levels keep every stride-th point, the coarsest one at least
+  // coarsest_size points of the smaller diagram
+  std::vector<size_t> strides;
+  for (size_t stride = ratio;multiscale.coarsest_size > 0 && size / stride >= multiscale.coarsest_size;stride *= ratio)
+    strides.push_back(stride);
+  if (strides.empty())
+    return hera::ws::wasserstein_cost_prepared(A, B, params);
+
+  const Grid grid(A, B);
+  const auto orderA = mortonOrder(A, grid);
+  const auto orderB = mortonOrder(B, grid);
+
+  // coarse to fine, the original diagrams last
+  std::vector<PreparedDiagram> levelsA, levelsB;
+  for (auto stride = strides.rbegin();stride != strides.rend();++stride)
+  {
+    levelsA.push_back(stratifiedSample(A, orderA, *stride));
+    levelsB.push_back(stratifiedSample(B, orderB, *stride));
+  }
+
+  std::vector<double> prices;
+  double epsilon = 0.0, distance = 0.0;
+  const PreparedDiagram* previousA = nullptr;
+  const PreparedDiagram* previousB = nullptr;
+  for (size_t level = 0;level <= levelsA.size();++level)
+  {
+    const bool finest = level == levelsA.size();
+    const PreparedDiagram& levelA = finest ? A : levelsA[level];
+    const PreparedDiagram& levelB = finest ? B : levelsB[level];
+    auto level_params = params;
+    if (!finest)
+    {
+      level_params.delta = std::max(params.delta, multiscale.coarse_delta);
+      level_params.return_matching = false;
+      if (equalPoints(levelA, levelB))
+        continue;
+    }
+
+    // item prices are those of the projections of the points of A, then
+    // those of the points of B, each carried over from the nearest point of
+    // the previous level
+    std::vector<double> level_prices;
+    if (previousA != nullptr &&
+        prices.size() == previousA->finite_points.size() + previousB->finite_points.size())
+    {
+      const auto split = prices.begin() + previousA->finite_points.size();
+      const std::vector<double> pricesA(prices.begin(), split), pricesB(split, prices.end());
+      level_prices.reserve(levelA.finite_points.size() + levelB.finite_points.size());
+      const double shift = std::max(
+        remapPrices(NearestPointIndex(previousA->finite_points), pricesA, levelA.finite_points, level_prices),
+        remapPrices(NearestPointIndex(previousB->finite_points), pricesB, levelB.finite_points, level_prices)
+      );
+      level_params.initial_epsilon = warmStartEpsilon(epsilon, distance, shift,
+                                                      params.wasserstein_power);
+    }
+
+    auto res = hera::ws::wasserstein_cost_prepared(levelA, levelB, level_params, level_prices);
+    if (finest)
+      return res;
+
+    prices = std::move(res.prices);
+    epsilon = res.final_epsilon;
+    distance = res.distance;
+    previousA = &levelA;
+    previousB = &levelB;
+  }
+
+  // not reached, the finest level always returns
+  return hera::ws::wasserstein_cost_prepared(A, B, params);
+}
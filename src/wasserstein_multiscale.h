@@ -0,0 +1,30 @@
+#ifndef PHUTIL_WASSERSTEIN_MULTISCALE_H
+#define PHUTIL_WASSERSTEIN_MULTISCALE_H
+
+#include "hera/wasserstein.h"
+
+#include <cstddef>
+
+// Coarse-to-fine auction for large diagrams. The finite points of each
+// diagram are sorted along a Morton curve over a grid covering both
+// diagrams, and level k keeps every (ratio^k)-th point, so that every grid
+// cell keeps a share of its points proportional to its mass and the levels
+// are nested samples of the same distribution. The coarsest level, of at
+// least coarsest_size points, is solved cold; the prices of each level are
+// carried over to the next finer one by nearest neighbour and passed to the
+// auction of the next level, down to the original points. Coarse levels
+// only need approximate prices and are solved to a relative error of
+// coarse_delta.
+struct MultiscaleParams
+{
+  size_t coarsest_size {1000};
+  unsigned int ratio {4};
+  double coarse_delta {0.05};
+};
+
+hera::AuctionResult<double> multiscaleWassersteinCost(const hera::ws::PreparedDiagram<double>& A,
+                                                      const hera::ws::PreparedDiagram<double>& B,
+                                                      const hera::AuctionParams<double>& params,
+                                                      const MultiscaleParams& multiscale = MultiscaleParams());
+
+#endif // PHUTIL_WASSERSTEIN_MULTISCALE_H
@@ -0,0 +1,151 @@
+// Wasserstein distances between point clouds, with the pure geometric
+// auction of Hera. WASSERSTEIN_PURE_GEOM changes the auction runners, so this
+// translation unit must not include the diagram auction of hera/wasserstein.h.
+#include "hera/wasserstein_pure_geom.hpp"
+
+#include <cpp11.hpp>
+
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using PointCloud = hera::ws::DynamicPointVector<double>;
+
+// The rows of an n x dim matrix as a point cloud: the container stores its
+// coordinates axis by axis, so that each column is copied into an axis, and
+// the point ids are the row indices.
+PointCloud parsePointCloud(const cpp11::doubles_matrix<>& x)
+{
+  const int n = x.nrow(), dim = x.ncol();
+  PointCloud result(dim);
+  result.resize(n);
+  for (int a = 0;a < dim;++a)
+  {
+    double* axis = result.axis(a);
+    for (int i = 0;i < n;++i)
+      axis[i] = x(i, a);
+  }
+  return result;
+}
+
+hera::AuctionParams<double> pointCloudParams(const int dim,
+                                             const double delta,
+                                             const double wasserstein_power,
+                                             const double internal_p,
+                                             const double deletion_cost)
+{
+  if (wasserstein_power < 1.0)
+    cpp11::stop("Wasserstein_degree must be a number >= 1.0. Cannot proceed.");
+  if (delta <= 0.0)
+    cpp11::stop("relative error must be a number > 0.0. Cannot proceed.");
+  if (internal_p < 1.0)
+    cpp11::stop("internal_p must be a number >= 1.0. Cannot proceed.");
+  if (std::isnan(deletion_cost) || deletion_cost < 0.0)
+    cpp11::stop("deletion_cost must be a number >= 0.0. Cannot proceed.");
+
+  hera::AuctionParams<double> params;
+  params.dim = dim;
+  params.wasserstein_power = wasserstein_power;
+  params.delta = delta;
+  params.internal_p = std::isinf(internal_p) ? hera::get_infinity<double>() : internal_p;
+  params.adaptive_epsilon = true;
+  // an infinite deletion cost asks for a perfect matching
+  params.deletion_cost = std::isinf(deletion_cost) ? -1.0 : deletion_cost;
+  return params;
+}
+
+double pointCloudDist(const PointCloud& a,
+                      const PointCloud& b,
+                      const hera::AuctionParams<double>& params)
+{
+  if (a.size() == 0 && b.size() == 0)
+    return 0.0;
+  const double cost = hera::ws::wasserstein_cost_detailed(a, b, params).cost;
+  return std::pow(cost, 1.0 / params.wasserstein_power);
+}
+
+// clouds of different sizes can only be compared with a partial matching
+void checkPointClouds(const cpp11::doubles_matrix<>& x,
+                      const cpp11::doubles_matrix<>& y,
+                      const double deletion_cost)
+{
+  if (x.ncol() != y.ncol())
+  {
+    std::string msg = "point clouds have different dimensions: " +
+      std::to_string(x.ncol()) + " != " + std::to_string(y.ncol()) + ".";
+    cpp11::stop(msg.c_str());
+  }
+  if (std::isinf(deletion_cost) && x.nrow() != y.nrow())
+  {
+    std::string msg = "point clouds have different sizes: " +
+      std::to_string(x.nrow()) + " != " + std::to_string(y.nrow()) + ".";
+    cpp11::stop(msg.c_str());
+  }
+}
+
+// Wasserstein distance between the rows of x and y, two matrices with the same
+// number of columns, for the internal_p norm (Inf for the max norm); a finite
+// deletion_cost allows a partial matching between clouds of any sizes. More
+// than one bid per round runs the Jacobi auction instead of Gauss-Seidel.
+[[cpp11::register]]
+double pointCloudWassersteinDistance(const cpp11::doubles_matrix<>& x,
+                                     const cpp11::doubles_matrix<>& y,
+                                     const double delta = 0.01,
+                                     const double wasserstein_power = 1.0,
+                                     const double internal_p = 2.0,
+                                     const double deletion_cost = std::numeric_limits<double>::infinity(),
+                                     const int max_bids_per_round = 1)
+{
+  if (max_bids_per_round < 1)
+    cpp11::stop("max_bids_per_round must be a number >= 1. Cannot proceed.");
+  checkPointClouds(x, y, deletion_cost);
+  auto params = pointCloudParams(x.ncol(), delta, wasserstein_power, internal_p, deletion_cost);
+  params.max_bids_per_round = max_bids_per_round;
+  return pointCloudDist(parsePointCloud(x), parsePointCloud(y), params);
+}
+
+// Pairwise distances between the point clouds of x, in the order of a 'dist'
+// object; all clouds are parsed before the parallel loop.
+[[cpp11::register]]
+cpp11::doubles pointCloudWassersteinPairwiseDistances(const cpp11::list& x,
+                                                      const double delta = 0.01,
+                                                      const double wasserstein_power = 1.0,
+                                                      const double internal_p = 2.0,
+                                                      const double deletion_cost = std::numeric_limits<double>::infinity(),
+                                                      const unsigned int ncores = 1)
+{
+  unsigned int N = x.size();
+  unsigned int K = N * (N - 1) / 2;
+  cpp11::writable::doubles result(K);
+  if (N == 0)
+    return result;
+
+  std::vector<cpp11::doubles_matrix<>> matrices;
+  for (unsigned int n = 0;n < N;++n)
+  {
+    matrices.push_back(cpp11::as_cpp<cpp11::doubles_matrix<>>(x[n]));
+    checkPointClouds(matrices[0], matrices.back(), deletion_cost);
+  }
+
+  const auto params = pointCloudParams(matrices[0].ncol(), delta, wasserstein_power, internal_p, deletion_cost);
+  std::vector<PointCloud> clouds;
+  for (const auto& matrix : matrices)
+    clouds.push_back(parsePointCloud(matrix));
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(ncores) schedule(dynamic)
+#endif
+  for (int k = 0;k < K;++k)
+  {
+    unsigned int i = N - 2 - std::floor(std::sqrt(-8 * k + 4 * N * (N - 1) - 7) / 2.0 - 0.5);
+    unsigned int j = k + i + 1 - N * (N - 1) / 2 + (N - i) * ((N - i) - 1) / 2;
+    result[k] = pointCloudDist(clouds[i], clouds[j], params);
+  }
+
+  return result;
+}
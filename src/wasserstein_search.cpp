@@ -0,0 +1,395 @@
+#include "wasserstein_search.h"
+#include "diagram_parser.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <tuple>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace
+{
+
+bool isFinitePoint(const std::pair<double,double>& point)
+{
+  return point.first != point.second &&
+    std::isfinite(point.first) && std::isfinite(point.second);
+}
+
+// Sum over the cells of the costs of the optimal matchings on the half line
+// of the values in each cell, the diagonal being 0.
+double gridCost(const BoundedDiagram::Values& a, const BoundedDiagram::Values& b, double q)
+{
+  double result = 0.0;
+  size_t i = 0, j = 0;
+  while (i < a.size() || j < b.size())
+  {
+    const long long cell = j == b.size() || (i < a.size() && a[i].first < b[j].first) ?
+      a[i].first : b[j].first;
+    while (i < a.size() && a[i].first == cell && j < b.size() && b[j].first == cell)
+      result += std::pow(std::fabs(a[i++].second - b[j++].second), q);
+    while (i < a.size() && a[i].first == cell)
+      result += std::pow(a[i++].second, q);
+    while (j < b.size() && b[j].first == cell)
+      result += std::pow(b[j++].second, q);
+  }
+  return result;
+}
+
+// Exact cost of the essential classes, infinite if they differ in number.
+double essentialCost(const hera::ws::PreparedDiagram<double>& a,
+                     const hera::ws::PreparedDiagram<double>& b,
+                     double q)
+{
+  if (a.n_plus_inf_minus_inf != b.n_plus_inf_minus_inf ||
+      a.n_minus_inf_plus_inf != b.n_minus_inf_plus_inf)
+    return std::numeric_limits<double>::infinity();
+
+  hera::AuctionParams<double> params;
+  params.wasserstein_power = q;
+  hera::AuctionResult<double> result;
+  hera::ws::get_one_dimensional_cost(a.x_plus, b.x_plus, params, result);
+  hera::ws::get_one_dimensional_cost(a.x_minus, b.x_minus, params, result);
+  hera::ws::get_one_dimensional_cost(a.y_plus, b.y_plus, params, result);
+  hera::ws::get_one_dimensional_cost(a.y_minus, b.y_minus, params, result);
+  return result.cost;
+}
+
+bool essentialCountsDiffer(const hera::ws::PreparedDiagram<double>& a,
+                           const hera::ws::PreparedDiagram<double>& b)
+{
+  return a.x_plus.size() != b.x_plus.size() || a.x_minus.size() != b.x_minus.size() ||
+    a.y_plus.size() != b.y_plus.size() || a.y_minus.size() != b.y_minus.size() ||
+    a.n_plus_inf_minus_inf != b.n_plus_inf_minus_inf ||
+    a.n_minus_inf_plus_inf != b.n_minus_inf_plus_inf;
+}
+
+}
+
+BoundedDiagram::BoundedDiagram(const std::vector<std::pair<double,double>>& diagram,
+                               const std::vector<BoundGrid>& grids,
+                               double wasserstein_power) :
+  values_(grids.size())
+{
+  for (size_t i = 0;i < diagram.size();++i)
+  {
+    const double b = diagram[i].first, d = diagram[i].second;
+    if (!isFinitePoint(diagram[i]))
+    {
+      essential_.add_point(b, d, i);
+      continue;
+    }
+    const double height = std::fabs(d - b) / 2.0;
+    norm_ += std::pow(height, wasserstein_power);
+    for (size_t k = 0;k < grids.size();++k)
+    {
+      const auto& grid = grids[k];
+      if (!std::isfinite(grid.side))
+      {
+        values_[k].emplace_back(0, height);
+        continue;
+      }
+      const double u = (b - grid.origin) / grid.side, v = (d - grid.origin) / grid.side;
+      const double i = std::floor(u), j = std::floor(v);
+      const double boundary = grid.side * std::min({u - i, i + 1.0 - u, v - j, j + 1.0 - v});
+      const double value = std::min(height, boundary);
+      if (value > 0.0)
+        values_[k].emplace_back(static_cast<long long>(i) * 4294967296LL + static_cast<long long>(j), value);
+    }
+  }
+  essential_.sort_essential();
+  norm_ = std::pow(norm_, 1.0 / wasserstein_power);
+  for (auto& values : values_)
+  {
+    std::sort(values.begin(), values.end(),
+              [](const std::pair<long long,double>& x, const std::pair<long long,double>& y) {
+                return x.first < y.first || (x.first == y.first && x.second > y.second);
+              });
+  }
+}
+
+std::vector<BoundGrid> boundGrids(const std::vector<std::vector<std::pair<double,double>>>& diagrams,
+                                  unsigned int num_scales)
+{
+  double lower = hera::get_infinity<double>(), upper = -lower;
+  for (const auto& diagram : diagrams)
+  {
+    for (const auto& point : diagram)
+    {
+      if (isFinitePoint(point))
+      {
+        lower = std::min({lower, point.first, point.second});
+        upper = std::max({upper, point.first, point.second});
+      }
+    }
+  }
+
+  std::vector<BoundGrid> result {{0.0, hera::get_infinity<double>()}};
+  if (!(upper > lower))
+    return result;
+  double side = upper - lower;
+  for (unsigned int s = 0;s < num_scales;++s, side /= 2.0)
+  {
+    result.push_back({lower, side});
+    result.push_back({lower - side / 2.0, side});
+  }
+  return result;
+}
+
+double normLowerBound(const BoundedDiagram& a, const BoundedDiagram& b)
+{
+  if (essentialCountsDiffer(a.essential(), b.essential()))
+    return std::numeric_limits<double>::infinity();
+  return std::fabs(a.norm() - b.norm());
+}
+
+double wassersteinLowerBound(const BoundedDiagram& a, const BoundedDiagram& b, double wasserstein_power)
+{
+  const double essential = essentialCost(a.essential(), b.essential(), wasserstein_power);
+  if (!std::isfinite(essential))
+    return essential;
+
+  double finite = 0.0;
+  for (size_t k = 0;k < a.num_grids();++k)
+    finite = std::max(finite, gridCost(a.values(k), b.values(k), wasserstein_power));
+  return std::pow(essential + finite, 1.0 / wasserstein_power);
+}
+
+WassersteinSearch::WassersteinSearch(const std::vector<Diagram>& references,
+                                     const hera::AuctionParams<double>& params,
+                                     unsigned int num_scales) :
+  params_(params),
+  references_(references),
+  grids_(boundGrids(references, num_scales))
+{
+  params_.remove_duplicates = params_.wasserstein_power == 1.0;
+  bounded_.reserve(references_.size());
+  for (const auto& reference : references_)
+    bounded_.emplace_back(reference, grids_, params_.wasserstein_power);
+}
+
+double WassersteinSearch::distance(const Diagram& query, size_t j) const
+{
+  return hera::wasserstein_cost_detailed(query, references_[j], params_).distance;
+}
+
+WassersteinSearch::Neighbours WassersteinSearch::knn(const Diagram& query, size_t k, Stats& stats) const
+{
+  const double q = params_.wasserstein_power;
+  const BoundedDiagram bounded(query, grids_, q);
+  k = std::min(k, references_.size());
+  if (k == 0)
+    return {};
+
+  // lower bound, whether it is the full one, reference
+  using Candidate = std::tuple<double, bool, size_t>;
+  std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> candidates;
+  for (size_t j = 0;j < references_.size();++j)
+    candidates.emplace(normLowerBound(bounded, bounded_[j]), false, j);
+
+  // the k best so far, the farthest on top
+  std::priority_queue<std::pair<double,size_t>> best;
+  while (!candidates.empty())
+  {
+    double bound;
+    bool refined;
+    size_t j;
+    std::tie(bound, refined, j) = candidates.top();
+    if (best.size() == k && bound >= best.top().first)
+      break;
+    candidates.pop();
+
+    if (!refined)
+    {
+      ++stats.num_bounds;
+      candidates.emplace(std::max(bound, wassersteinLowerBound(bounded, bounded_[j], q)), true, j);
+      continue;
+    }
+
+    ++stats.num_auctions;
+    const double d = distance(query, j);
+    if (best.size() < k)
+      best.emplace(d, j);
+    else if (d < best.top().first)
+    {
+      best.pop();
+      best.emplace(d, j);
+    }
+  }
+
+  Neighbours result(best.size());
+  for (size_t i = result.size();i-- > 0;)
+  {
+    result[i] = std::make_pair(best.top().second, best.top().first);
+    best.pop();
+  }
+  return result;
+}
+
+WassersteinSearch::Neighbours WassersteinSearch::range(const Diagram& query, double radius, Stats& stats) const
+{
+  const double q = params_.wasserstein_power;
+  const BoundedDiagram bounded(query, grids_, q);
+
+  Neighbours result;
+  for (size_t j = 0;j < references_.size();++j)
+  {
+    if (normLowerBound(bounded, bounded_[j]) > radius)
+      continue;
+    ++stats.num_bounds;
+    if (wassersteinLowerBound(bounded, bounded_[j], q) > radius)
+      continue;
+    ++stats.num_auctions;
+    const double d = distance(query, j);
+    if (d <= radius)
+      result.emplace_back(j, d);
+  }
+
+  std::sort(result.begin(), result.end(),
+            [](const std::pair<size_t,double>& a, const std::pair<size_t,double>& b) {
+              return a.second < b.second;
+            });
+  return result;
+}
+
+std::vector<PairVector> parseDiagrams(const cpp11::list& x)
+{
+  std::vector<PairVector> result(x.size());
+  for (int n = 0;n < x.size();++n)
+    parseMatrix(cpp11::as_cpp<cpp11::doubles_matrix<>>(x[n]), result[n]);
+  return result;
+}
+
+hera::AuctionParams<double> searchParams(const double delta, const double wasserstein_power)
+{
+  hera::AuctionParams<double> params;
+  params.wasserstein_power = wasserstein_power;
+  params.delta = delta;
+  params.adaptive_epsilon = true;
+  if (params.wasserstein_power < 1.0)
+    cpp11::stop("Wasserstein_degree must be a number >= 1.0. Cannot proceed.");
+  if (params.delta <= 0.0)
+    cpp11::stop("relative error must be a number > 0.0. Cannot proceed.");
+  return params;
+}
+
+// Lower bound on the Wasserstein distance between two diagrams, the grids
+// spanning both.
+[[cpp11::register]]
+double wassersteinDistanceLowerBound(const cpp11::doubles_matrix<>& x,
+                                     const cpp11::doubles_matrix<>& y,
+                                     const double wasserstein_power = 1.0,
+                                     const int num_scales = 6)
+{
+  std::vector<PairVector> diagrams(2);
+  parseMatrix(x, diagrams[0]);
+  parseMatrix(y, diagrams[1]);
+  const auto grids = boundGrids(diagrams, num_scales);
+  return wassersteinLowerBound(BoundedDiagram(diagrams[0], grids, wasserstein_power),
+                               BoundedDiagram(diagrams[1], grids, wasserstein_power),
+                               wasserstein_power);
+}
+
+// The k nearest diagrams of y to every diagram of x, as matrices of 1-based
+// indices and distances with one row per query, and the number of full lower
+// bounds and auctions computed for each query.
+[[cpp11::register]]
+cpp11::list wassersteinKnn(const cpp11::list& x,
+                           const cpp11::list& y,
+                           const int k = 1,
+                           const double delta = 0.01,
+                           const double wasserstein_power = 1.0,
+                           const unsigned int ncores = 1)
+{
+  using namespace cpp11::literals;
+
+  const auto queries = parseDiagrams(x);
+  const WassersteinSearch search(parseDiagrams(y), searchParams(delta, wasserstein_power));
+
+  const int N = queries.size();
+  std::vector<WassersteinSearch::Neighbours> neighbours(N);
+  std::vector<WassersteinSearch::Stats> stats(N);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(ncores) schedule(dynamic)
+#endif
+  for (int i = 0;i < N;++i)
+    neighbours[i] = search.knn(queries[i], k, stats[i]);
+
+  const int K = std::min<size_t>(k, search.size());
+  cpp11::writable::integers_matrix<> indices(N, K);
+  cpp11::writable::doubles_matrix<> distances(N, K);
+  cpp11::writable::integers num_bounds(N), num_auctions(N);
+  for (int i = 0;i < N;++i)
+  {
+    for (int j = 0;j < K;++j)
+    {
+      indices(i, j) = neighbours[i][j].first + 1;
+      distances(i, j) = neighbours[i][j].second;
+    }
+    num_bounds[i] = stats[i].num_bounds;
+    num_auctions[i] = stats[i].num_auctions;
+  }
+
+  return cpp11::writable::list({
+    "index"_nm = indices,
+    "distance"_nm = distances,
+    "num_bounds"_nm = num_bounds,
+    "num_auctions"_nm = num_auctions
+  });
+}
+
+// The diagrams of y within radius of every diagram of x, as a list with one
+// list(index, distance) per query, and the number of full lower bounds and
+// auctions computed for each query.
+[[cpp11::register]]
+cpp11::list wassersteinRangeSearch(const cpp11::list& x,
+                                   const cpp11::list& y,
+                                   const double radius,
+                                   const double delta = 0.01,
+                                   const double wasserstein_power = 1.0,
+                                   const unsigned int ncores = 1)
+{
+  using namespace cpp11::literals;
+
+  const auto queries = parseDiagrams(x);
+  const WassersteinSearch search(parseDiagrams(y), searchParams(delta, wasserstein_power));
+
+  const int N = queries.size();
+  std::vector<WassersteinSearch::Neighbours> neighbours(N);
+  std::vector<WassersteinSearch::Stats> stats(N);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(ncores) schedule(dynamic)
+#endif
+  for (int i = 0;i < N;++i)
+    neighbours[i] = search.range(queries[i], radius, stats[i]);
+
+  cpp11::writable::list matches(N);
+  cpp11::writable::integers num_bounds(N), num_auctions(N);
+  for (int i = 0;i < N;++i)
+  {
+    const int M = neighbours[i].size();
+    cpp11::writable::integers index(M);
+    cpp11::writable::doubles distance(M);
+    for (int j = 0;j < M;++j)
+    {
+      index[j] = neighbours[i][j].first + 1;
+      distance[j] = neighbours[i][j].second;
+    }
+    matches[i] = cpp11::writable::list({
+      "index"_nm = index,
+      "distance"_nm = distance
+    });
+    num_bounds[i] = stats[i].num_bounds;
+    num_auctions[i] = stats[i].num_auctions;
+  }
+
+  return cpp11::writable::list({
+    "matches"_nm = matches,
+    "num_bounds"_nm = num_bounds,
+    "num_auctions"_nm = num_auctions
+  });
+}
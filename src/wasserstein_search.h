@@ -0,0 +1,107 @@
+#ifndef PHUTIL_WASSERSTEIN_SEARCH_H
+#define PHUTIL_WASSERSTEIN_SEARCH_H
+
+#include "hera/wasserstein.h"
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Cells of a square grid over the half plane above the diagonal. The grid
+// with infinite side has a single cell.
+struct BoundGrid
+{
+  double origin {0.0};
+  double side {0.0};
+};
+
+// A persistence diagram prepared for lower bounds on the Wasserstein distance
+// with the l_inf ground metric. For disjoint open sets U_i above the
+// diagonal, the map x -> (d(x, U_1^c), ..., d(x, U_m^c)) is 1-Lipschitz from
+// l_inf to l_1 (a segment from x to y leaves the set of x before it enters
+// the set of y) and vanishes on the diagonal. A matching of two diagrams
+// thus costs at least the sum over the sets of the optimal matchings on the
+// half line of the values in each set, the diagonal being 0, and on the half
+// line the optimal matching pairs the values sorted in decreasing order, the
+// shorter side padded with zeros. The sets are the cells of grids of several
+// sides and offsets, cut by the diagonal; the single cell of the coarsest
+// grid gives the distance to the diagonal (d - b) / 2. Essential classes are
+// matched exactly by their finite coordinate.
+class BoundedDiagram
+{
+public:
+  // cell and distance to its boundary, by cell and decreasing distance
+  using Values = std::vector<std::pair<long long,double>>;
+
+  BoundedDiagram() = default;
+  BoundedDiagram(const std::vector<std::pair<double,double>>& diagram,
+                 const std::vector<BoundGrid>& grids,
+                 double wasserstein_power);
+
+  const Values& values(size_t k) const { return values_[k]; }
+  size_t num_grids() const { return values_.size(); }
+  // l_q norm of the distances to the diagonal
+  double norm() const { return norm_; }
+  const hera::ws::PreparedDiagram<double>& essential() const { return essential_; }
+
+private:
+  std::vector<Values> values_;
+  double norm_ {0.0};
+  hera::ws::PreparedDiagram<double> essential_;
+};
+
+// The grid with a single cell, then num_scales grids whose sides halve from
+// the extent of the finite points of the diagrams, each also shifted by half
+// a side.
+std::vector<BoundGrid> boundGrids(const std::vector<std::vector<std::pair<double,double>>>& diagrams,
+                                  unsigned int num_scales);
+
+// | ||a||_q - ||b||_q | over the distances to the diagonal, by the reverse
+// triangle inequality; O(1), infinite if the essential classes differ in
+// number.
+double normLowerBound(const BoundedDiagram& a, const BoundedDiagram& b);
+
+// Largest of the grid bounds, added to the cost of the essential classes;
+// O(n + m) per grid.
+double wassersteinLowerBound(const BoundedDiagram& a, const BoundedDiagram& b, double wasserstein_power);
+
+// Nearest-neighbour and range search among reference diagrams. Candidates
+// are visited by increasing lower bound, the O(1) bound being refined to the
+// full one when a candidate comes up first, and the auction only runs for
+// candidates whose bound is below the current k-th distance (or the radius).
+// As the auction overestimates the distance, the pruned candidates are
+// certified to be farther.
+class WassersteinSearch
+{
+public:
+  using Diagram = std::vector<std::pair<double,double>>;
+  // reference and distance
+  using Neighbours = std::vector<std::pair<size_t,double>>;
+
+  struct Stats
+  {
+    int num_bounds {0};
+    int num_auctions {0};
+  };
+
+  WassersteinSearch(const std::vector<Diagram>& references,
+                    const hera::AuctionParams<double>& params,
+                    unsigned int num_scales = 6);
+
+  size_t size() const { return references_.size(); }
+
+  // k nearest references, by increasing distance
+  Neighbours knn(const Diagram& query, size_t k, Stats& stats) const;
+  // references within radius, by increasing distance
+  Neighbours range(const Diagram& query, double radius, Stats& stats) const;
+
+private:
+  double distance(const Diagram& query, size_t j) const;
+
+  hera::AuctionParams<double> params_;
+  std::vector<Diagram> references_;
+  std::vector<BoundGrid> grids_;
+  std::vector<BoundedDiagram> bounded_;
+};
+
+#endif // PHUTIL_WASSERSTEIN_SEARCH_H
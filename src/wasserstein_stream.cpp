@@ -0,0 +1,53 @@
+#include "wasserstein_stream.h"
+
+#include <algorithm>
+#include <limits>
+
+WassersteinStream::WassersteinStream(const hera::AuctionParams<double>& params,
+                                     unsigned int lag) :
+  params_(params),
+  lag_(lag),
+  ring_(lag + 2)
+{
+}
+
+double WassersteinStream::push(const std::vector<std::pair<double,double>>& diagram)
+{
+  const size_t t = count_++;
+  Entry& current = entry(t);
+  hera::ws::prepare_diagram(diagram, current.diagram);
+  current.index.build(current.diagram.finite_points);
+
+  if (t < lag_)
+    return std::numeric_limits<double>::quiet_NaN();
+
+  const Entry& bidders = entry(t - lag_);
+  auto params = params_;
+
+  // warm start from the previous pair (D_{t - lag - 1}, D_{t - 1})
+  std::vector<double> prices;
+  if (t > lag_ && !prices_.empty())
+  {
+    const Entry& previous_bidders = entry(t - lag_ - 1);
+    const Entry& previous_items = entry(t - 1);
+    const size_t num_bidder_items = previous_bidders.diagram.finite_points.size();
+    std::vector<double> bidder_prices(prices_.begin(), prices_.begin() + num_bidder_items);
+    std::vector<double> item_prices(prices_.begin() + num_bidder_items, prices_.end());
+
+    prices.reserve(bidders.diagram.finite_points.size() + current.diagram.finite_points.size());
+    double shift = std::max(
+      remapPrices(previous_bidders.index, bidder_prices, bidders.diagram.finite_points, prices),
+      remapPrices(previous_items.index, item_prices, current.diagram.finite_points, prices)
+    );
+    params.initial_epsilon = warmStartEpsilon(epsilon_, distance_, shift,
+                                              params.wasserstein_power);
+  }
+
+  auto res = hera::ws::wasserstein_cost_prepared(bidders.diagram, current.diagram, params, prices);
+
+  prices_ = std::move(res.prices);
+  epsilon_ = res.final_epsilon;
+  distance_ = res.distance;
+
+  return res.distance;
+}
@@ -0,0 +1,47 @@
+#ifndef PHUTIL_WASSERSTEIN_STREAM_H
+#define PHUTIL_WASSERSTEIN_STREAM_H
+
+#include "hera/wasserstein.h"
+#include "warm_start.h"
+
+#include <utility>
+#include <vector>
+
+// Wasserstein distances along a stream of persistence diagrams: every diagram
+// D_t fed in is compared with D_{t - lag}. Each diagram is prepared once
+// (finite points, sorted infinite classes and a nearest-neighbour index) and
+// kept in a ring buffer for as long as it is needed, and every auction is
+// warm-started from the prices of the previous pair.
+class WassersteinStream
+{
+public:
+  WassersteinStream(const hera::AuctionParams<double>& params, unsigned int lag = 1);
+
+  // Feeds the next diagram; returns W(D_{t - lag}, D_t), or NaN while fewer
+  // than lag + 1 diagrams have been fed.
+  double push(const std::vector<std::pair<double,double>>& diagram);
+
+  size_t size() const { return count_; }
+
+private:
+  struct Entry
+  {
+    hera::ws::PreparedDiagram<double> diagram;
+    NearestPointIndex index;
+  };
+
+  Entry& entry(size_t t) { return ring_[t % ring_.size()]; }
+
+  hera::AuctionParams<double> params_;
+  unsigned int lag_;
+  // D_{t - lag - 1} is still needed to remap the prices of the previous pair
+  std::vector<Entry> ring_;
+  size_t count_ {0};
+
+  // prices of the last pair, in the item layout of wasserstein_cost_prepared
+  std::vector<double> prices_;
+  double epsilon_ {0.0};
+  double distance_ {0.0};
+};
+
+#endif // PHUTIL_WASSERSTEIN_STREAM_H